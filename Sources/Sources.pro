@@ -29,7 +29,19 @@ SOURCES +=  main.cpp\
             mappingdialog.cpp \
             qharmonicmap.cpp \
             qvideoslider.cpp \
-            qprocessingdialog.cpp
+            qprocessingdialog.cpp \
+            qframering.cpp \
+            qmappedvideo.cpp \
+            qstreammanager.cpp \
+            qsegmentanalyzer.cpp \
+            qreadaheaddecoder.cpp \
+            qsyntheticvideo.cpp \
+            qroikernels.cpp \
+            qcolorclassifier.cpp \
+            qfacedetector.cpp \
+            qscratcharena.cpp \
+            qharmonicregions.cpp \
+            qgraypyramid.cpp
 
 HEADERS  += mainwindow.h \
             qimagewidget.h \
@@ -43,7 +55,22 @@ HEADERS  += mainwindow.h \
             mappingdialog.h \
             qharmonicmap.h \
             qvideoslider.h \
-            qprocessingdialog.h
+            qprocessingdialog.h \
+            qframering.h \
+            qmappedvideo.h \
+            qstreammanager.h \
+            qsegmentanalyzer.h \
+            qreadaheaddecoder.h \
+            qsyntheticvideo.h \
+            qroikernels.h \
+            qcolorclassifier.h \
+            qmapframe.h \
+            qfacedetector.h \
+            qroioverlay.h \
+            qscratcharena.h \
+            qfaceregions.h \
+            qharmonicregions.h \
+            qgraypyramid.h
 
 FORMS += qsettingsdialog.ui \
          mappingdialog.ui \
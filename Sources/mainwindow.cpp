@@ -73,6 +73,14 @@ void MainWindow::createActions()
     pt_openSessionAct->setStatusTip(tr("Open new measurement session"));
     connect(pt_openSessionAct, SIGNAL(triggered()), this, SLOT(configure_and_start_session()));
 
+    pt_addStreamsAct = new QAction(tr("&Add streams"),this);
+    pt_addStreamsAct->setStatusTip(tr("Measure other video files in background, every stream writes its own measurements record"));
+    connect(pt_addStreamsAct, SIGNAL(triggered()), this, SLOT(addStreams()));
+
+    pt_analyzeAct = new QAction(tr("Analy&ze file"),this);
+    pt_analyzeAct->setStatusTip(tr("Measure a long video file offline, segments of the file are processed in parallel"));
+    connect(pt_analyzeAct, SIGNAL(triggered()), this, SLOT(analyzeFile()));
+
     pt_pauseAct = new QAction(tr("&Pause"), this);
     pt_pauseAct->setStatusTip(tr("Stop a measurement session"));
     connect(pt_pauseAct, SIGNAL(triggered()), this, SLOT(onpause()));
@@ -195,6 +203,93 @@ void MainWindow::createActions()
     pt_prunAct->setStatusTip(tr("Toggles experimental color pruning algorithm"));
     pt_prunAct->setCheckable(true);
     pt_prunAct->setChecked(false);
+
+    pt_trackAct = new QAction(tr("Face &tracking"), this);
+    pt_trackAct->setStatusTip(tr("Detect face on downscaled image from time to time and track it between detections"));
+    pt_trackAct->setCheckable(true);
+    pt_trackAct->setChecked(false);
+
+    pt_asyncDetectionAct = new QAction(tr("&Asynchronous detection"), this);
+    pt_asyncDetectionAct->setStatusTip(tr("Detect face in a separate thread, signal is extracted on every frame with the latest face position"));
+    pt_asyncDetectionAct->setCheckable(true);
+    pt_asyncDetectionAct->setChecked(false);
+
+    pt_faceRegionsAct = new QAction(tr("Face &regions"), this);
+    pt_faceRegionsAct->setStatusTip(tr("Measure forehead and cheeks separately in the same pass and show the region with the best SNR"));
+    pt_faceRegionsAct->setCheckable(true);
+    pt_faceRegionsAct->setChecked(false);
+
+    pt_unthrottledAct = new QAction(tr("&Unthrottled"), this);
+    pt_unthrottledAct->setStatusTip(tr("Process video files as fast as possible, time is taken from the file timestamps"));
+    pt_unthrottledAct->setCheckable(true);
+    pt_unthrottledAct->setChecked(false);
+
+    pt_nativeYUVAct = new QAction(tr("Native &YUV"), this);
+    pt_nativeYUVAct->setStatusTip(tr("Process YUV frames of the device or Y4M file without conversion to BGR, preview shows luma only"));
+    pt_nativeYUVAct->setCheckable(true);
+    pt_nativeYUVAct->setChecked(false);
+
+    pt_queueActGroup = new QActionGroup(this);
+    pt_queueMapper = new QSignalMapper(this);
+    pt_blockAct = new QAction(tr("Block"), pt_queueActGroup);
+    pt_blockAct->setStatusTip(tr("Capture waits while processing is late, no frames are lost"));
+    pt_blockAct->setCheckable(true);
+    pt_queueMapper->setMapping(pt_blockAct, QFrameRing::BlockPolicy);
+    connect(pt_blockAct, SIGNAL(triggered()), pt_queueMapper, SLOT(map()));
+    pt_boundedAct = new QAction(tr("Bounded queue"), pt_queueActGroup);
+    pt_boundedAct->setStatusTip(tr("Capture drops new frames while the queue is full"));
+    pt_boundedAct->setCheckable(true);
+    pt_queueMapper->setMapping(pt_boundedAct, QFrameRing::BoundedPolicy);
+    connect(pt_boundedAct, SIGNAL(triggered()), pt_queueMapper, SLOT(map()));
+    pt_latestAct = new QAction(tr("Latest frame"), pt_queueActGroup);
+    pt_latestAct->setStatusTip(tr("Processing always takes the newest frame, older unprocessed frames are discarded"));
+    pt_latestAct->setCheckable(true);
+    pt_queueMapper->setMapping(pt_latestAct, QFrameRing::LatestPolicy);
+    connect(pt_latestAct, SIGNAL(triggered()), pt_queueMapper, SLOT(map()));
+    pt_boundedAct->setChecked(true);
+    connect(pt_queueMapper, SIGNAL(mapped(int)), this, SLOT(setQueuePolicy(int)));
+
+    pt_readAheadActGroup = new QActionGroup(this);
+    pt_readAheadMapper = new QSignalMapper(this);
+    QList<int> depths;
+    depths << 0 << DEFAULT_READ_AHEAD_DEPTH / 2 << DEFAULT_READ_AHEAD_DEPTH << DEFAULT_READ_AHEAD_DEPTH * 2;
+    for(int i = 0; i < depths.size(); i++)
+    {
+        QAction *action = new QAction(depths.at(i) > 0 ? tr("%1 frames").arg(depths.at(i)) : tr("Off"), pt_readAheadActGroup);
+        action->setStatusTip(tr("Depth of the background decoding queue, takes effect for the next opened video file"));
+        action->setCheckable(true);
+        action->setChecked(depths.at(i) == 0);
+        pt_readAheadMapper->setMapping(action, depths.at(i));
+        connect(action, SIGNAL(triggered()), pt_readAheadMapper, SLOT(map()));
+    }
+
+    pt_skinRuleActGroup = new QActionGroup(this);
+    pt_skinRuleMapper = new QSignalMapper(this);
+    QStringList rules;
+    rules << tr("Modified Kovac") << tr("Kovac") << tr("Swift");
+    for(int i = 0; i < rules.size(); i++)
+    {
+        QAction *action = new QAction(rules.at(i), pt_skinRuleActGroup);
+        action->setStatusTip(tr("Rule that decides which colors are enrolled as skin"));
+        action->setCheckable(true);
+        action->setChecked(i == QColorClassifier::ModifiedKovacRule);
+        pt_skinRuleMapper->setMapping(action, i); // actions follow the order of QColorClassifier::SkinRule
+        connect(action, SIGNAL(triggered()), pt_skinRuleMapper, SLOT(map()));
+    }
+
+    pt_samplingActGroup = new QActionGroup(this);
+    pt_samplingMapper = new QSignalMapper(this);
+    QStringList samplings;
+    samplings << tr("Every pixel") << tr("Checkerboard, 1/2") << tr("Checkerboard, 1/4");
+    for(int i = 0; i < samplings.size(); i++)
+    {
+        QAction *action = new QAction(samplings.at(i), pt_samplingActGroup);
+        action->setStatusTip(tr("Part of the region pixels that are summed, the sampling error is shown on the image"));
+        action->setCheckable(true);
+        action->setChecked(i == 0);
+        pt_samplingMapper->setMapping(action, 1 << i); // stride 1, 2 or 4
+        connect(action, SIGNAL(triggered()), pt_samplingMapper, SLOT(map()));
+    }
 }
 
 //------------------------------------------------------------------------------------
@@ -203,6 +298,8 @@ void MainWindow::createMenus()
 {
     pt_fileMenu = this->menuBar()->addMenu(tr("&Session"));
     pt_fileMenu->addAction(pt_openSessionAct);
+    pt_fileMenu->addAction(pt_addStreamsAct);
+    pt_fileMenu->addAction(pt_analyzeAct);
     pt_fileMenu->addSeparator();
     pt_fileMenu->addAction(pt_exitAct);
 
@@ -217,9 +314,23 @@ void MainWindow::createMenus()
     pt_modeMenu->addAction(pt_pcaAct);
     pt_modeMenu->addSeparator();
     pt_modeMenu->addAction(pt_skinAct);
+    pt_skinRuleMenu = pt_modeMenu->addMenu(tr("Skin &rule"));
+    pt_skinRuleMenu->addActions(pt_skinRuleActGroup->actions());
+    pt_samplingMenu = pt_modeMenu->addMenu(tr("S&ampling"));
+    pt_samplingMenu->addActions(pt_samplingActGroup->actions());
     pt_modeMenu->addAction(pt_calibAct);
+    pt_modeMenu->addAction(pt_trackAct);
+    pt_modeMenu->addAction(pt_asyncDetectionAct);
+    pt_modeMenu->addAction(pt_faceRegionsAct);
     pt_modeMenu->addSeparator();
     pt_modeMenu->addAction(pt_prunAct);
+    pt_modeMenu->addSeparator();
+    pt_modeMenu->addAction(pt_unthrottledAct);
+    pt_modeMenu->addAction(pt_nativeYUVAct);
+    pt_queueMenu = pt_modeMenu->addMenu(tr("&Queue"));
+    pt_queueMenu->addActions(pt_queueActGroup->actions());
+    pt_readAheadMenu = pt_modeMenu->addMenu(tr("&Read-ahead"));
+    pt_readAheadMenu->addActions(pt_readAheadActGroup->actions());
     pt_optionsMenu->setEnabled(false);
 
     pt_RecordsMenu = this->menuBar()->addMenu(tr("&Records"));
@@ -256,10 +367,21 @@ void MainWindow::createThreads()
     connect(pt_improcThread, SIGNAL(finished()), pt_opencvProcessor, SLOT(deleteLater()));
     connect(pt_skinAct, SIGNAL(triggered(bool)), pt_opencvProcessor, SLOT(setSkinSearchingFlag(bool)));
     connect(pt_calibAct, SIGNAL(triggered(bool)), pt_opencvProcessor, SLOT(calibrate(bool)));
+    connect(pt_trackAct, SIGNAL(triggered(bool)), pt_opencvProcessor, SLOT(setFaceTracking(bool)));
+    connect(pt_asyncDetectionAct, SIGNAL(triggered(bool)), pt_opencvProcessor, SLOT(setAsyncDetection(bool)));
+    connect(pt_faceRegionsAct, SIGNAL(triggered(bool)), pt_opencvProcessor, SLOT(setFaceRegions(bool)));
+    connect(pt_faceRegionsAct, SIGNAL(triggered()), pt_display, SLOT(clearRegionString()));
+    connect(pt_skinRuleMapper, SIGNAL(mapped(int)), pt_opencvProcessor, SLOT(setSkinRule(int)));
+    connect(pt_samplingMapper, SIGNAL(mapped(int)), pt_opencvProcessor, SLOT(setSampleStride(int)));
     //---------------------------------------------------------------
 
     pt_harmonicProcessor = NULL;
+    pt_harmonicRegions = NULL;
     pt_harmonicThread = NULL;
+    pt_streamManager = NULL;
+    pt_segmentAnalyzer = new QSegmentAnalyzer(this);
+    connect(pt_segmentAnalyzer, SIGNAL(progressUpdated(int)), this, SLOT(showAnalysisProgress(int)));
+    connect(pt_segmentAnalyzer, SIGNAL(analysisFinished(bool)), this, SLOT(analysisFinished(bool)));
     pt_map = NULL;
     pt_mapThread = NULL;
 
@@ -270,19 +392,35 @@ void MainWindow::createThreads()
     connect(pt_videoThread, &QThread::started, pt_videoCapture, &QVideoCapture::initiallizeTimer);
     connect(pt_videoThread, &QThread::finished, pt_videoCapture, &QVideoCapture::deleteLater);
 
+    //--------------------Frame ring---------------------------------
+    pt_frameRing = new QFrameRing(DEFAULT_FRAME_RING_LENGTH); // capture thread writes frames here and does not wait for processing
+    pt_videoCapture->setFrameRing(pt_frameRing);
+    pt_opencvProcessor->setFrameRing(pt_frameRing);
+
     //----------Register openCV types in Qt meta-type system---------
     qRegisterMetaType<cv::Mat>("cv::Mat");
     qRegisterMetaType<cv::Rect>("cv::Rect");
+    qRegisterMetaType<QMapFrame>("QMapFrame");
+    qRegisterMetaType<QRoiOverlay>("QRoiOverlay");
 
     //----------------------Connections------------------------------
+    connect(pt_opencvProcessor, SIGNAL(overlayProcessed(QRoiOverlay)), pt_display, SLOT(updateOverlay(QRoiOverlay)), Qt::BlockingQueuedConnection);
     connect(pt_opencvProcessor, SIGNAL(frameProcessed(cv::Mat,double,quint32)), pt_display, SLOT(updateImage(cv::Mat,double,quint32)), Qt::BlockingQueuedConnection);
     connect(pt_display, SIGNAL(rect_was_entered(cv::Rect)), pt_opencvProcessor, SLOT(setRect(cv::Rect)));
     connect(pt_opencvProcessor, SIGNAL(selectRegion(const char*)), pt_display, SLOT(set_warning_status(const char*)));
     connect(pt_opencvProcessor, SIGNAL(mapRegionUpdated(cv::Rect)), pt_display, SLOT(updadeMapRegion(cv::Rect)));
+    connect(pt_opencvProcessor, SIGNAL(stagesTimed(qreal,qreal)), pt_display, SLOT(updateStagesTime(qreal,qreal)));
+    connect(pt_opencvProcessor, SIGNAL(queueStatus(quint32,quint32)), pt_display, SLOT(updateQueueStatus(quint32,quint32)));
+    connect(pt_opencvProcessor, SIGNAL(samplingErrorEstimated(qreal)), pt_display, SLOT(updateSamplingError(qreal)));
+    connect(pt_videoCapture, SIGNAL(frameQueued()), pt_opencvProcessor, SLOT(processQueuedFrames()));
+    connect(pt_opencvProcessor, SIGNAL(slotsReleased()), pt_videoCapture, SLOT(continueWriting()));
     connect(this, &MainWindow::pauseVideo, pt_videoCapture, &QVideoCapture::pause);
     connect(this, &MainWindow::resumeVideo, pt_videoCapture, &QVideoCapture::resume);
     connect(this, &MainWindow::closeVideo, pt_videoCapture, &QVideoCapture::close);
-    connect(this, &MainWindow::updateTimer, pt_opencvProcessor, &QOpencvProcessor::updateTime);
+    connect(pt_unthrottledAct, &QAction::triggered, pt_videoCapture, &QVideoCapture::setUnthrottled);
+    connect(pt_nativeYUVAct, &QAction::triggered, pt_videoCapture, &QVideoCapture::setNativeYUV);
+    connect(pt_readAheadMapper, SIGNAL(mapped(int)), pt_videoCapture, SLOT(setReadAheadDepth(int)));
+    connect(pt_videoCapture, SIGNAL(readAheadDepth(quint16)), pt_display, SLOT(updateReadAheadDepth(quint16)));
     //----------------------Thread start-----------------------------
     pt_improcThread->start();
     pt_videoThread->start();
@@ -308,12 +446,12 @@ void MainWindow::contextMenuEvent(QContextMenuEvent *event)
 
 bool MainWindow::openvideofile()
 {
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Open video file"), "/video", tr("Video (*.avi *.mp4 *.wmv *.mpeg1)"));
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open video file"), "/video", tr("Video (*.avi *.mp4 *.wmv *.mpeg1)") + ";;" + tr("Uncompressed video (*.y4m *.bgr)") + ";;" + tr("Synthetic video (*.synth)"));
     while( !pt_videoCapture->openfile(fileName) ) {
         QMessageBox msgBox(QMessageBox::Information, this->windowTitle(), tr("Can not open video file!"), QMessageBox::Open | QMessageBox::Cancel, this, Qt::Dialog);
         if( msgBox.exec() == QMessageBox::Open )
         {
-            fileName = QFileDialog::getOpenFileName(this, tr("Open video file"), "/video", tr("Video (*.avi *.mp4 *.wmv *.mpeg1)"));
+            fileName = QFileDialog::getOpenFileName(this, tr("Open video file"), "/video", tr("Video (*.avi *.mp4 *.wmv *.mpeg1)") + ";;" + tr("Uncompressed video (*.y4m *.bgr)") + ";;" + tr("Synthetic video (*.synth)"));
         } else {
             return false;
         }
@@ -416,6 +554,13 @@ void MainWindow::show_help()
 
 MainWindow::~MainWindow()
 {
+    // ring slots can hold headers into the file mapping of QVideoCapture, so the processor stops before the capture closes the file,
+    // blocking connections to the display are removed first, otherwise wait() below would wait for this thread
+    disconnect(pt_opencvProcessor, SIGNAL(overlayProcessed(QRoiOverlay)), pt_display, SLOT(updateOverlay(QRoiOverlay)));
+    disconnect(pt_opencvProcessor, SIGNAL(frameProcessed(cv::Mat,double,quint32)), pt_display, SLOT(updateImage(cv::Mat,double,quint32)));
+    pt_improcThread->quit();
+    pt_improcThread->wait();
+
     emit closeVideo();
 
     if(m_signalsFile.isOpen())
@@ -430,8 +575,7 @@ MainWindow::~MainWindow()
     pt_videoThread->quit();
     pt_videoThread->wait();
 
-    pt_improcThread->quit();
-    pt_improcThread->wait();
+    delete pt_frameRing;
 
     if(pt_map)
     {
@@ -459,7 +603,6 @@ void MainWindow::onpause()
 void MainWindow::onresume()
 {
     emit resumeVideo();
-    emit updateTimer();
     m_timer.start();
 }
 
@@ -516,6 +659,9 @@ void MainWindow::configure_and_start_session()
         pt_harmonicProcessor = new QHarmonicProcessor(NULL, m_settingsDialog.get_datalength(), m_settingsDialog.get_bufferlength());
         pt_harmonicProcessor->moveToThread(pt_harmonicThread);
         connect(pt_harmonicThread, SIGNAL(finished()),pt_harmonicProcessor, SLOT(deleteLater()));
+        pt_harmonicRegions = new QHarmonicRegions(NULL, m_settingsDialog.get_datalength(), m_settingsDialog.get_bufferlength()); // it gets frames only while face regions are on
+        pt_harmonicRegions->moveToThread(pt_harmonicThread);
+        connect(pt_harmonicThread, SIGNAL(finished()),pt_harmonicRegions, SLOT(deleteLater()));
         connect(pt_harmonicThread, SIGNAL(finished()),pt_harmonicThread, SLOT(deleteLater()));
         //---------------------------------------------------------------
         if(m_signalsFile.isOpen()) {
@@ -538,8 +684,8 @@ void MainWindow::configure_and_start_session()
             }
         }
         //---------------------------------------------------------------
-        disconnect(pt_videoCapture,SIGNAL(frame_was_captured(cv::Mat)), pt_opencvProcessor, SLOT(faceProcess(cv::Mat)));
-        disconnect(pt_videoCapture,SIGNAL(frame_was_captured(cv::Mat)), pt_opencvProcessor, SLOT(rectProcess(cv::Mat)));
+        disconnect(pt_opencvProcessor, SIGNAL(frameDequeued(cv::Mat)), pt_opencvProcessor, SLOT(faceProcess(cv::Mat)));
+        disconnect(pt_opencvProcessor, SIGNAL(frameDequeued(cv::Mat)), pt_opencvProcessor, SLOT(rectProcess(cv::Mat)));
         if(m_settingsDialog.get_flagCascade())
         {
             QString filename = m_settingsDialog.get_stringCascade();
@@ -559,11 +705,11 @@ void MainWindow::configure_and_start_session()
                     break;
                 }
             }
-            connect(pt_videoCapture, SIGNAL(frame_was_captured(cv::Mat)), pt_opencvProcessor, SLOT(faceProcess(cv::Mat)), Qt::BlockingQueuedConnection);
+            connect(pt_opencvProcessor, SIGNAL(frameDequeued(cv::Mat)), pt_opencvProcessor, SLOT(faceProcess(cv::Mat)), Qt::DirectConnection);
         }
         else
         {
-            connect(pt_videoCapture, SIGNAL(frame_was_captured(cv::Mat)), pt_opencvProcessor, SLOT(rectProcess(cv::Mat)), Qt::BlockingQueuedConnection);
+            connect(pt_opencvProcessor, SIGNAL(frameDequeued(cv::Mat)), pt_opencvProcessor, SLOT(rectProcess(cv::Mat)), Qt::DirectConnection);
         }
         //--------------------------------------------------------------      
         if(m_settingsDialog.get_FFTflag())
@@ -585,6 +731,12 @@ void MainWindow::configure_and_start_session()
         connect(pt_pcaAct, SIGNAL(triggered(bool)), pt_harmonicProcessor, SLOT(setPCAMode(bool)));
         connect(pt_prunAct, SIGNAL(triggered(bool)), pt_harmonicProcessor, SLOT(setPruning(bool)));
         connect(pt_harmonicProcessor, SIGNAL(CurrentValues(qreal,qreal,qreal,qreal)), this, SLOT(make_record_to_file(qreal,qreal,qreal,qreal)));
+        connect(&m_timer, SIGNAL(timeout()), pt_harmonicRegions, SLOT(computeHeartRates()));
+        connect(pt_opencvProcessor, SIGNAL(regionsCollected(QMapFrame)), pt_harmonicRegions, SLOT(updateHarmonicProcessors(QMapFrame)));
+        connect(pt_harmonicRegions, SIGNAL(regionSelected(quint32,qreal,qreal)), pt_display, SLOT(updateRegionString(quint32,qreal,qreal)));
+        connect(pt_harmonicRegions, SIGNAL(regionsTooNoisy()), pt_display, SLOT(clearRegionString()));
+        connect(pt_colorMapper, SIGNAL(mapped(int)), pt_harmonicRegions, SLOT(switchColorMode(int)));
+        connect(pt_pcaAct, SIGNAL(triggered(bool)), pt_harmonicRegions, SLOT(setPCAMode(bool)));
         pt_harmonicThread->start();
 
         m_timer.setInterval( m_settingsDialog.get_timerValue() );     
@@ -782,6 +934,7 @@ void MainWindow::make_record_to_file(qreal signalValue, qreal meanRed, qreal mea
 void MainWindow::closeEvent(QCloseEvent*)
 {
     closeAllDialogs();
+    disconnect(pt_opencvProcessor, SIGNAL(overlayProcessed(QRoiOverlay)), pt_display, SLOT(updateOverlay(QRoiOverlay)));
     disconnect(pt_opencvProcessor, SIGNAL(frameProcessed(cv::Mat,double,quint32)), pt_display, SLOT(updateImage(cv::Mat,double,quint32)));
 }
 
@@ -856,7 +1009,7 @@ void MainWindow::openMapDialog()
             //--------Clean memory and resources------
             if(pt_map)
             {
-                disconnect(pt_videoCapture, SIGNAL(frame_was_captured(cv::Mat)), pt_opencvProcessor, SLOT(mapProcess(cv::Mat)));
+                disconnect(pt_opencvProcessor, SIGNAL(frameDequeued(cv::Mat)), pt_opencvProcessor, SLOT(mapProcess(cv::Mat)));
                 disconnect(&m_timer, SIGNAL(timeout()), pt_map, SIGNAL(updateMap()));
                 disconnect(pt_map, SIGNAL(mapUpdated(const qreal*,quint32,quint32,qreal,qreal)), pt_display, SLOT(updateMap(const qreal*,quint32,quint32,qreal,qreal)));
                 pt_display->clearMap();
@@ -885,10 +1038,10 @@ void MainWindow::openMapDialog()
                     pt_map = new QHarmonicProcessorMap(NULL, dialog.getMapWidth(), dialog.getMapHeight());
                     pt_map->setMapType(dialog.getMapType(), dialog.getSNRControl());
                     pt_map->moveToThread(pt_mapThread);
-                    connect(pt_opencvProcessor, SIGNAL(mapCellProcessed(ulong,ulong,ulong,ulong,double)), pt_map, SLOT(updateHarmonicProcessor(ulong,ulong,ulong,ulong,double)), Qt::BlockingQueuedConnection);
+                    connect(pt_opencvProcessor, SIGNAL(mapProcessed(QMapFrame)), pt_map, SLOT(updateHarmonicProcessors(QMapFrame)), Qt::BlockingQueuedConnection);
                     connect(&m_timer, SIGNAL(timeout()), pt_map, SIGNAL(updateMap()));
                     connect(pt_map, SIGNAL(mapUpdated(const qreal*,quint32,quint32,qreal,qreal)), pt_display, SLOT(updateMap(const qreal*,quint32,quint32,qreal,qreal)));
-                    connect(pt_videoCapture, SIGNAL(frame_was_captured(cv::Mat)), pt_opencvProcessor, SLOT(mapProcess(cv::Mat)), Qt::BlockingQueuedConnection);
+                    connect(pt_opencvProcessor, SIGNAL(frameDequeued(cv::Mat)), pt_opencvProcessor, SLOT(mapProcess(cv::Mat)), Qt::DirectConnection);
                     connect(pt_pcaAct, SIGNAL(triggered(bool)), pt_map, SIGNAL(updatePCAMode(bool)));
                     connect(pt_colorMapper, SIGNAL(mapped(int)), pt_map, SIGNAL(changeColorChannel(int)));
                     connect(pt_mapThread, SIGNAL(finished()), pt_mapThread, SLOT(deleteLater()));
@@ -982,4 +1135,95 @@ void MainWindow::updateMeasurementsRecord(qreal heartRate, qreal heartSNR, qreal
     }
 }
 
+//----------------------------------------------------------------------------------------
+
+void MainWindow::setQueuePolicy(int value)
+{
+    pt_frameRing->setPolicy( (QFrameRing::Policy)value );
+}
 
+//----------------------------------------------------------------------------------------
+
+void MainWindow::addStreams()
+{
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Add streams"), QString(), tr("Video (*.avi *.mp4 *.wmv *.mpeg1)") + ";;" + tr("Uncompressed video (*.y4m *.bgr)") + ";;" + tr("Synthetic video (*.synth)"));
+    if(fileNames.isEmpty())
+    {
+        return;
+    }
+    if(pt_streamManager == NULL)
+    {
+        pt_streamManager = new QStreamManager(this, 0, m_settingsDialog.get_datalength(), m_settingsDialog.get_bufferlength());
+        pt_streamManager->setEstimationPeriod(m_settingsDialog.get_timerValue());
+    }
+    QStringList failed;
+    for(int i = 0; i < fileNames.size(); i++)
+    {
+        QFileInfo info(fileNames.at(i));
+        QString record = info.absolutePath() + "/" + info.completeBaseName() + "_measurements.txt";
+        if(pt_streamManager->addFileStream(fileNames.at(i), m_settingsDialog.get_stringCascade(), record) < 0)
+        {
+            failed.append(info.fileName());
+        }
+    }
+    if(!failed.isEmpty())
+    {
+        QMessageBox msgBox(QMessageBox::Information, this->windowTitle(), tr("Can not start streams for: ") + failed.join(", ") + tr("\nCheck the cascade in the session settings"), QMessageBox::Ok, this, Qt::Dialog);
+        msgBox.exec();
+    }
+    statusBar()->showMessage(tr("Streams in background: ") + QString::number(pt_streamManager->count()) + tr(", worker threads: ") + QString::number(pt_streamManager->threadCount()));
+}
+
+//----------------------------------------------------------------------------------------
+
+void MainWindow::analyzeFile()
+{
+    if(pt_segmentAnalyzer->isRunning())
+    {
+        QMessageBox msgBox(QMessageBox::Question, this->windowTitle(), tr("Analysis is running. Abort it?"), QMessageBox::Yes | QMessageBox::No, this, Qt::Dialog);
+        if(msgBox.exec() == QMessageBox::Yes)
+        {
+            pt_segmentAnalyzer->abort();
+        }
+        return;
+    }
+    QString cascade;
+    if(m_settingsDialog.get_flagCascade())
+    {
+        cascade = m_settingsDialog.get_stringCascade();
+    }
+    cv::Rect rect = pt_opencvProcessor->getRect();
+    if(cascade.isEmpty() && (rect.area() == 0))
+    {
+        QMessageBox msgBox(QMessageBox::Information, this->windowTitle(), tr("Select region on image or enable face detection in the session settings"), QMessageBox::Ok, this, Qt::Dialog);
+        msgBox.exec();
+        return;
+    }
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Analyze file"), QString(), tr("Video (*.avi *.mp4 *.wmv *.mpeg1)") + ";;" + tr("Uncompressed video (*.y4m *.bgr)") + ";;" + tr("Synthetic video (*.synth)"));
+    if(fileName.isEmpty())
+    {
+        return;
+    }
+    QFileInfo info(fileName);
+    pt_segmentAnalyzer->setProcessing(cascade, rect);
+    pt_segmentAnalyzer->setHarmonic(m_settingsDialog.get_datalength(), m_settingsDialog.get_bufferlength(), m_settingsDialog.get_FFTflag(), m_settingsDialog.get_timerValue());
+    if(!pt_segmentAnalyzer->start(fileName, info.absolutePath() + "/" + info.completeBaseName() + "_analysis.txt"))
+    {
+        QMessageBox msgBox(QMessageBox::Information, this->windowTitle(), tr("Can not open video file"), QMessageBox::Ok, this, Qt::Dialog);
+        msgBox.exec();
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void MainWindow::showAnalysisProgress(int percent)
+{
+    statusBar()->showMessage(tr("Analysis: ") + QString::number(percent) + "%");
+}
+
+//----------------------------------------------------------------------------------------
+
+void MainWindow::analysisFinished(bool success)
+{
+    statusBar()->showMessage(success ? tr("Analysis is done, see *_analysis.txt next to the video file") : tr("Analysis is aborted or record can not be written"));
+}
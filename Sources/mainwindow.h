@@ -19,6 +19,7 @@
 #include <QTextStream>
 #include <QActionGroup>
 #include <QSignalMapper>
+#include <QFileInfo>
 
 #include "qimagewidget.h"
 #include "qopencvprocessor.h"
@@ -26,11 +27,15 @@
 #include "about.h"
 #include "qharmonicprocessor.h"
 #include "qharmonicmap.h"
+#include "qharmonicregions.h"
 #include "qsettingsdialog.h"
 #include "qeasyplot.h"
 #include "qbackgroundwidget.h"
 #include "mappingdialog.h"
 #include "qvideoslider.h"
+#include "qframering.h"
+#include "qstreammanager.h"
+#include "qsegmentanalyzer.h"
 
 #define LIMIT_OF_DIALOGS_NUMBER 5
 //------------------------------------------------------------------------------------------------------
@@ -46,7 +51,6 @@ signals:
     void pauseVideo();
     void resumeVideo();
     void closeVideo();
-    void updateTimer();
 
 protected:
     void contextMenuEvent(QContextMenuEvent *event);
@@ -68,6 +72,9 @@ public slots:
     void startMeasurementsRecord();
     void openMapDialog();
     void openProcessingDialog();
+    void setQueuePolicy(int value); // see QFrameRing::Policy
+    void addStreams();              // starts background measurements of the selected video files, see QStreamManager
+    void analyzeFile();             // starts or aborts offline measurement of a long video file, see QSegmentAnalyzer
 
 private:
     void createActions();
@@ -81,6 +88,8 @@ private:
     QVideoSlider *pt_videoSlider;
     QLabel *pt_infoLabel;
     QAction *pt_openSessionAct;
+    QAction *pt_addStreamsAct;
+    QAction *pt_analyzeAct;
     QAction *pt_exitAct;
     QAction *pt_aboutAct;
     QAction *pt_helpAct;
@@ -99,8 +108,24 @@ private:
     QAction *pt_adjustAct;
     QAction *pt_imageAct;
     QAction *pt_calibAct;
+    QAction *pt_trackAct;
+    QAction *pt_asyncDetectionAct;
+    QAction *pt_faceRegionsAct;
     QAction *pt_measRecAct;
     QAction *pt_prunAct;
+    QAction *pt_unthrottledAct;
+    QAction *pt_nativeYUVAct;
+    QActionGroup *pt_queueActGroup;
+    QSignalMapper *pt_queueMapper;
+    QAction *pt_blockAct;
+    QAction *pt_boundedAct;
+    QAction *pt_latestAct;
+    QActionGroup *pt_readAheadActGroup;
+    QSignalMapper *pt_readAheadMapper;
+    QActionGroup *pt_skinRuleActGroup;
+    QSignalMapper *pt_skinRuleMapper;
+    QActionGroup *pt_samplingActGroup;
+    QSignalMapper *pt_samplingMapper;
     QMenu *pt_RecordsMenu;
     QMenu *pt_fileMenu;
     QMenu *pt_optionsMenu;
@@ -108,14 +133,22 @@ private:
     QMenu *pt_helpMenu;
     QMenu *pt_colormodeMenu;
     QMenu *pt_modeMenu;
+    QMenu *pt_queueMenu;
+    QMenu *pt_readAheadMenu;
+    QMenu *pt_skinRuleMenu;
+    QMenu *pt_samplingMenu;
     QMenu *pt_appearenceMenu;
     QVideoCapture *pt_videoCapture;
     QOpencvProcessor *pt_opencvProcessor;
+    QFrameRing *pt_frameRing;
+    QStreamManager *pt_streamManager;
+    QSegmentAnalyzer *pt_segmentAnalyzer;
     QThread *pt_improcThread;
     QThread *pt_harmonicThread;
     QThread *pt_videoThread;
     QThread *pt_mapThread;
     QHarmonicProcessor *pt_harmonicProcessor;
+    QHarmonicRegions *pt_harmonicRegions;
     QTimer m_timer;
     QDialog *pt_dialogSet[LIMIT_OF_DIALOGS_NUMBER];
     quint8 m_dialogSetCounter;
@@ -144,6 +177,8 @@ private slots:
     void closeAllDialogs();
     void make_record_to_file(qreal signalValue, qreal meanRed, qreal meanGreen, qreal meanBlue);
     void updateMeasurementsRecord(qreal heartRate, qreal heartSNR, qreal breathRate, qreal breathSNR);
+    void showAnalysisProgress(int percent);
+    void analysisFinished(bool success);
 };
 //------------------------------------------------------------------------------------------------------
 #endif // MAINWINDOW_H
@@ -0,0 +1,138 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QColorClassifier answers "is it skin" and "is it calibration colour" by table lookup. Skin rule is
+tabulated once for every colour quantised to SKIN_LUT_BITS bits per channel, one bit per colour, tables
+of the built-in rules are shared by all instances and live till the end of the program. Calibration
+predicate is a 256-entry table of green values rebuilt only by setCalibration(...).
+------------------------------------------------------------------------------------------------------*/
+
+#include "qcolorclassifier.h"
+#include "qroikernels.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <cstring>
+
+#define SKIN_RULES 3
+#define SKIN_LUT_SIZE ((1u << (3*SKIN_LUT_BITS)) / 8)
+
+static QMutex tablesMutex;
+static unsigned char *v_skinTables[SKIN_RULES] = {0}; // built on the first request, never released
+
+//------------------------------------------------------------------------------------------------------
+
+QColorClassifier::QColorClassifier():
+    m_skinRule(ModifiedKovacRule),
+    pt_skinTable(skinTable(ModifiedKovacRule))
+{
+    setCalibration(0.0, 0.0); // nothing passes until calibration is done
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QColorClassifier::setSkinRule(SkinRule rule)
+{
+    if((rule >= 0) && (rule < SKIN_RULES))
+    {
+        m_skinRule = rule;
+        pt_skinTable = skinTable(rule);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QColorClassifier::SkinRule QColorClassifier::skinRule() const
+{
+    return m_skinRule;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QColorClassifier::isExactModifiedKovac() const
+{
+    return (m_skinRule == ModifiedKovacRule) && (SKIN_LUT_BITS == 8);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QColorClassifier::setCalibration(double mean, double error)
+{
+    m_greenMin = 255;
+    m_greenMax = 0;
+    for(int i = 0; i < 256; i++)
+    {
+        v_calibTable[i] = ((i < (mean + error)) && (i > (mean - error))) ? 1 : 0;
+        if(v_calibTable[i])
+        {
+            if(i < m_greenMin)
+                m_greenMin = i;
+            m_greenMax = i;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+unsigned char QColorClassifier::greenMin() const
+{
+    return m_greenMin;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+unsigned char QColorClassifier::greenMax() const
+{
+    return m_greenMax;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QColorClassifier::skinRuleValue(SkinRule rule, unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue)
+{
+    //from Ghazali Osman Muhammad, Suzuri Hitam and Mohd Nasir Ismail
+    //"ENHANCED SKIN COLOUR CLASSIFIER USING RGB RATIO MODEL" International Journal on Soft Computing (IJSC) Vol.3, No.4, November 2012
+    switch(rule)
+    {
+        case SwiftRule:
+            return !( (valueBlue > valueRed)    &&
+                      (valueGreen < valueBlue)  &&
+                      (valueGreen > valueRed)   &&
+                      ( (valueBlue < (valueRed >> 2)) || (valueBlue > 200) ) );
+        case KovacRule:
+            return (valueRed > 95) && (valueRed > valueGreen)   &&
+                   (valueGreen > 40) && (valueBlue > 20)        &&
+                   ((valueRed - qMin(valueGreen,valueBlue)) > 15) &&
+                   ((valueRed - valueGreen) > 15);
+        default:
+            return QRoiKernels::isSkin(valueRed, valueGreen, valueBlue); // Modified Kovac's rule
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+const unsigned char *QColorClassifier::skinTable(SkinRule rule)
+{
+    QMutexLocker locker(&tablesMutex);
+    if(v_skinTables[rule] == 0)
+    {
+        unsigned char *table = new unsigned char[SKIN_LUT_SIZE];
+        std::memset(table, 0, SKIN_LUT_SIZE);
+        const int shift = 8 - SKIN_LUT_BITS;
+        const int half = (1 << shift) >> 1; // quantised colour is represented by the centre of its cell
+        for(unsigned int red = 0; red < (1u << SKIN_LUT_BITS); red++)
+        {
+            for(unsigned int green = 0; green < (1u << SKIN_LUT_BITS); green++)
+            {
+                for(unsigned int blue = 0; blue < (1u << SKIN_LUT_BITS); blue++)
+                {
+                    if(skinRuleValue(rule, (red << shift) | half, (green << shift) | half, (blue << shift) | half))
+                    {
+                        unsigned int index = (red << (2*SKIN_LUT_BITS)) | (green << SKIN_LUT_BITS) | blue;
+                        table[index >> 3] |= (1 << (index & 7));
+                    }
+                }
+            }
+        }
+        v_skinTables[rule] = table;
+    }
+    return v_skinTables[rule];
+}
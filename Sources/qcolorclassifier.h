@@ -0,0 +1,68 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QColorClassifier answers "is it skin" and "is it calibration colour" by table lookup. Skin rule is
+tabulated once for every colour quantised to SKIN_LUT_BITS bits per channel, one bit per colour, tables
+of the built-in rules are shared by all instances and live till the end of the program. Calibration
+predicate is a 256-entry table of green values rebuilt only by setCalibration(...). So the rule set can
+be swapped without any per-pixel cost, to add a rule extend SkinRule and skinRuleValue(...).
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QCOLORCLASSIFIER_H
+#define QCOLORCLASSIFIER_H
+//------------------------------------------------------------------------------------------------------
+
+#define SKIN_LUT_BITS 8 // bits per channel in skin table index, 8 gives exact 2 MB table, 6 gives 32 KB table with small quantisation error
+
+//------------------------------------------------------------------------------------------------------
+
+class QColorClassifier
+{
+public:
+    enum SkinRule
+    {
+        ModifiedKovacRule,      // default, SIMD kernels of QRoiKernels evaluate it without table
+        KovacRule,
+        SwiftRule
+    };
+
+    QColorClassifier();
+
+    void setSkinRule(SkinRule rule);
+    SkinRule skinRule() const;
+    bool isExactModifiedKovac() const;  // true if table gives the same answers as QRoiKernels::isSkin(...)
+    void setCalibration(double mean, double error); // enrolls green values in (mean - error, mean + error)
+    bool isSkin(unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue) const;
+    bool isCalib(unsigned char valueGreen) const;
+    unsigned char greenMin() const;     // calibration table as a range, greenMin > greenMax for empty one
+    unsigned char greenMax() const;
+
+private:
+    SkinRule m_skinRule;
+    const unsigned char *pt_skinTable;  // shared table of m_skinRule
+    unsigned char v_calibTable[256];
+    unsigned char m_greenMin;
+    unsigned char m_greenMax;
+
+    static const unsigned char *skinTable(SkinRule rule);
+    static bool skinRuleValue(SkinRule rule, unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue);
+};
+
+//------------------------------------------------------------------------------------------------------
+
+inline bool QColorClassifier::isSkin(unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue) const
+{
+    unsigned int index = ((unsigned int)(valueRed >> (8 - SKIN_LUT_BITS)) << (2*SKIN_LUT_BITS)) |
+                         ((unsigned int)(valueGreen >> (8 - SKIN_LUT_BITS)) << SKIN_LUT_BITS) |
+                          (unsigned int)(valueBlue >> (8 - SKIN_LUT_BITS));
+    return (pt_skinTable[index >> 3] >> (index & 7)) & 1;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+inline bool QColorClassifier::isCalib(unsigned char valueGreen) const
+{
+    return v_calibTable[valueGreen] != 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+#endif // QCOLORCLASSIFIER_H
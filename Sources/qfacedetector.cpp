@@ -0,0 +1,102 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QFaceDetector runs the cascade classifier in its own thread, so slow detection does not delay extraction
+of the signal. Only the latest submitted image waits for detection, the latest result is published
+under a mutex together with a generation number.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qfacedetector.h"
+#include <QMutexLocker>
+
+//------------------------------------------------------------------------------------------------------
+
+QFaceDetector::QFaceDetector(int minSize, QObject *parent):
+    QObject(parent),
+    m_minSize(minSize),
+    m_pendingFlag(false),
+    m_busyFlag(false),
+    m_face(0, 0, 0, 0),
+    m_generation(0),
+    m_takenGeneration(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QFaceDetector::loadClassifier(const QString &filename)
+{
+    return m_classifier.load(filename.toStdString());
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QFaceDetector::submit(const cv::Mat &image)
+{
+    QMutexLocker locker(&m_mutex);
+    image.copyTo(m_pending); // memory is reused while the image size is the same
+    m_pendingFlag = true;
+    if(!m_busyFlag)
+    {
+        m_busyFlag = true;
+        QMetaObject::invokeMethod(this, "detect", Qt::QueuedConnection);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QFaceDetector::detect()
+{
+    forever
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            if(!m_pendingFlag)
+            {
+                m_busyFlag = false;
+                return;
+            }
+            cv::swap(m_pending, m_working);
+            m_pendingFlag = false;
+        }
+
+        std::vector<cv::Rect> faces;
+        if(!m_classifier.empty())
+        {
+            m_classifier.detectMultiScale(m_working, faces, 1.1, 11, cv::CASCADE_DO_ROUGH_SEARCH|cv::CASCADE_FIND_BIGGEST_OBJECT, cv::Size(m_minSize, m_minSize));
+        }
+        cv::Rect face = (faces.size() > 0) ? faces[0] : cv::Rect(0, 0, 0, 0);
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_face = face;
+            if(face.area() > 0)
+            {
+                m_working(face).copyTo(m_patch);
+            }
+            m_generation++;
+        }
+        emit faceDetected(face);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QFaceDetector::takeResult(cv::Rect &face, cv::Mat &patch)
+{
+    QMutexLocker locker(&m_mutex);
+    if(m_generation == m_takenGeneration)
+    {
+        return false;
+    }
+    m_takenGeneration = m_generation;
+    face = m_face;
+    if(face.area() > 0)
+    {
+        if((patch.cols >= face.width) && (patch.rows >= face.height) && (patch.type() == m_patch.type()))
+        {
+            patch = patch(cv::Rect(0, 0, face.width, face.height)); // memory of the caller is reused
+        }
+        m_patch.copyTo(patch);
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QFaceDetector runs the cascade classifier in its own thread, so slow detection does not delay extraction
+of the signal. Producer calls submit(...) with a grayscale image on every frame, only the latest image
+waits for detection, older ones are replaced. The latest result (face rectangle and the face patch
+from the image it was found on) is published under a mutex together with a generation number, so
+consumer can take it by takeResult(...) at any time and knows whether it is new.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QFACEDETECTOR_H
+#define QFACEDETECTOR_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QObject>
+#include <QMutex>
+#include <QString>
+#include <opencv2/opencv.hpp>
+
+//------------------------------------------------------------------------------------------------------
+
+class QFaceDetector : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QFaceDetector(int minSize, QObject *parent = 0);
+
+    void submit(const cv::Mat &image);      // any thread, copies image into the pending buffer and wakes detector up if it is idle
+    bool takeResult(cv::Rect &face, cv::Mat &patch); // any thread, returns true and the result if it has changed since the previous call, patch memory is reused if it is large enough
+
+signals:
+    void faceDetected(const cv::Rect &face); // emitted after each detection, empty rect if face was not found
+
+public slots:
+    bool loadClassifier(const QString &filename);
+    void detect();                          // processes pending images while they come
+
+private:
+    cv::CascadeClassifier m_classifier;
+    int m_minSize;
+    QMutex m_mutex;         // guards all members below
+    cv::Mat m_pending;      // the latest submitted image
+    bool m_pendingFlag;
+    bool m_busyFlag;        // detect() is queued or running
+    cv::Mat m_working;      // image that is processed by detect() now, it is swapped with m_pending
+    cv::Rect m_face;        // the latest result
+    cv::Mat m_patch;
+    quint32 m_generation;   // incremented with each result
+    quint32 m_takenGeneration;
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QFACEDETECTOR_H
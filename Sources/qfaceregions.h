@@ -0,0 +1,70 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QFaceRegions names the sub-regions of the face that QOpencvProcessor::faceProcess(...) accumulates in the
+same pass as the whole face. Every sub-region is defined relative to the face rectangle of the cascade,
+so it follows the face size and position. Sums of the sub-regions go out as cells of QMapFrame with
+the region as id, QHarmonicRegions feeds each of them to its own QHarmonicProcessor.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QFACEREGIONS_H
+#define QFACEREGIONS_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QtGlobal>
+#include <opencv2/opencv.hpp>
+
+#define FACE_REGIONS 3 // number of values of QFaceRegions::Region
+
+//------------------------------------------------------------------------------------------------------
+
+class QFaceRegions
+{
+public:
+    enum Region
+    {
+        Forehead = 0,
+        LeftCheek = 1,      // left in the image
+        RightCheek = 2
+    };
+
+    static cv::Rect region(int id, const cv::Rect &face);  // sub-region id of the face rectangle in the frame coordinates
+    static const char *name(int id);                        // translate it in QImageWidget context
+};
+
+//------------------------------------------------------------------------------------------------------
+
+inline cv::Rect QFaceRegions::region(int id, const cv::Rect &face)
+{
+    // left, top, width and height in parts of the face rectangle
+    static const double fractions[FACE_REGIONS][4] = {
+        {0.30, 0.06, 0.40, 0.14},   // above the eyebrows, the cascade rectangle starts at the middle of the forehead
+        {0.14, 0.56, 0.22, 0.20},   // below the eye, outside of the nose and the mouth corner
+        {0.64, 0.56, 0.22, 0.20}
+    };
+    if((id < 0) || (id >= FACE_REGIONS))
+    {
+        return cv::Rect();
+    }
+    return cv::Rect(face.x + cvRound(fractions[id][0]*face.width), face.y + cvRound(fractions[id][1]*face.height),
+                    cvRound(fractions[id][2]*face.width), cvRound(fractions[id][3]*face.height));
+}
+
+//------------------------------------------------------------------------------------------------------
+
+inline const char *QFaceRegions::name(int id)
+{
+    switch(id)
+    {
+        case Forehead:
+            return QT_TRANSLATE_NOOP("QImageWidget", "forehead");
+        case LeftCheek:
+            return QT_TRANSLATE_NOOP("QImageWidget", "left cheek");
+        case RightCheek:
+            return QT_TRANSLATE_NOOP("QImageWidget", "right cheek");
+        default:
+            return "";
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+#endif // QFACEREGIONS_H
@@ -0,0 +1,161 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QFrameRing is a single-producer/single-consumer ring of cv::Mat buffers. It is used to pass frames
+from QVideoCapture thread to QOpencvProcessor thread without blocking of the capture on processing.
+Producer: call writeSlot(), fill slot, call commit(). Consumer: call readSlot(), use slot, call release().
+Back-pressure policy tells the producer what to do when the consumer is late, see Policy. For
+LatestPolicy the ring works as a mailbox: three extra slots are exchanged through one atomic index
+(triple buffering), so the producer never waits and the consumer always gets the newest frame.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qframering.h"
+
+#define MAILBOX_FRESH 4
+
+//------------------------------------------------------------------------------------------------------
+
+QFrameRing::QFrameRing(quint16 length):
+    m_length(length > 0 ? length : 1),
+    m_head(0),
+    m_tail(0),
+    m_policy(BoundedPolicy),
+    m_mailboxFlag(false),
+    m_mailboxRead(false),
+    m_mailbox(1),
+    m_back(0),
+    m_front(2),
+    m_dropped(0),
+    m_coalesced(0)
+{
+    v_slots = new Slot[m_length + MAILBOX_LENGTH];
+    for(quint16 i = 0; i < m_length + MAILBOX_LENGTH; i++)
+    {
+        v_slots[i].format = BGRFormat;
+        v_slots[i].captureTime = 0.0;
+        v_slots[i].timestamp = 0.0;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QFrameRing::~QFrameRing()
+{
+    delete[] v_slots;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QFrameRing::Slot *QFrameRing::writeSlot()
+{
+    bool latest = (m_policy.load() == LatestPolicy);
+    if(latest != m_mailboxFlag)
+    {
+        // frames should not be reordered, so mode is switched only when the consumer has taken everything from the current one
+        if(m_mailboxFlag ? ((m_mailbox.loadAcquire() & MAILBOX_FRESH) == 0) : (count() == 0))
+        {
+            m_mailboxFlag = latest;
+        }
+    }
+
+    if(m_mailboxFlag)
+    {
+        return &v_slots[m_length + m_back];
+    }
+
+    int head = m_head.load(); // only producer changes m_head
+    if(((2*m_length + head - m_tail.loadAcquire()) % (2*m_length)) == m_length)
+    {
+        return NULL; // ring is full
+    }
+    return &v_slots[head % m_length];
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QFrameRing::commit()
+{
+    if(m_mailboxFlag)
+    {
+        int previous = m_mailbox.fetchAndStoreOrdered(m_back | MAILBOX_FRESH);
+        if(previous & MAILBOX_FRESH)
+        {
+            m_coalesced.ref(); // the consumer has not taken the previous frame
+        }
+        m_back = previous & ~MAILBOX_FRESH;
+        return;
+    }
+    m_head.storeRelease( (m_head.load() + 1) % (2*m_length) );
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QFrameRing::Slot *QFrameRing::readSlot()
+{
+    int tail = m_tail.load(); // only consumer changes m_tail
+    if(m_head.loadAcquire() != tail)
+    {
+        m_mailboxRead = false;
+        return &v_slots[tail % m_length];
+    }
+    if(m_mailbox.loadAcquire() & MAILBOX_FRESH) // only consumer clears this bit, so it can not disappear before the exchange
+    {
+        m_front = m_mailbox.fetchAndStoreOrdered(m_front) & ~MAILBOX_FRESH;
+        m_mailboxRead = true;
+        return &v_slots[m_length + m_front];
+    }
+    return NULL; // ring and mailbox are empty
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QFrameRing::release()
+{
+    if(m_mailboxRead)
+    {
+        m_mailboxRead = false; // mailbox slot stays with the consumer until the next exchange
+        return;
+    }
+    m_tail.storeRelease( (m_tail.load() + 1) % (2*m_length) );
+}
+
+//------------------------------------------------------------------------------------------------------
+
+quint16 QFrameRing::length() const
+{
+    return m_length;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QFrameRing::setPolicy(Policy policy)
+{
+    m_policy.store(policy);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QFrameRing::Policy QFrameRing::policy() const
+{
+    return (Policy)m_policy.load();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QFrameRing::countDropped()
+{
+    m_dropped.ref();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+quint32 QFrameRing::dropped() const
+{
+    return m_dropped.load();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+quint32 QFrameRing::coalesced() const
+{
+    return m_coalesced.load();
+}
@@ -0,0 +1,87 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QFrameRing is a single-producer/single-consumer ring of cv::Mat buffers. It is used to pass frames
+from QVideoCapture thread to QOpencvProcessor thread without blocking of the capture on processing.
+Producer: call writeSlot(), fill slot, call commit(). Consumer: call readSlot(), use slot, call release().
+Back-pressure policy tells the producer what to do when the consumer is late, see Policy. For
+LatestPolicy the ring works as a mailbox: three extra slots are exchanged through one atomic index
+(triple buffering), so the producer never waits and the consumer always gets the newest frame.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QFRAMERING_H
+#define QFRAMERING_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QAtomicInt>
+#include <opencv2/opencv.hpp>
+
+#define DEFAULT_FRAME_RING_LENGTH 4
+#define MAILBOX_LENGTH 3
+
+//------------------------------------------------------------------------------------------------------
+
+class QFrameRing
+{
+public:
+    enum PixelFormat
+    {
+        BGRFormat,              // BGR or grayscale cv::Mat as cv::VideoCapture delivers it
+        I420Format,             // planar YUV 4:2:0, single channel cv::Mat with height*3/2 rows: Y plane, then U and V planes
+        YUYVFormat              // packed YUV 4:2:2, two channel cv::Mat: Y,U for even and Y,V for odd pixels
+    };
+
+    struct Slot
+    {
+        cv::Mat frame;          // frame buffer, memory is allocated on first write and reused while frame size is the same
+        PixelFormat format;     // layout of the frame data
+        double captureTime;     // time spent by the producer to grab this frame, in ms
+        double timestamp;       // monotonic capture time of the frame assigned by the producer (container timestamps for video files), in ms
+    };
+
+    enum Policy
+    {
+        BlockPolicy,            // producer waits for a free slot, no frames are lost
+        BoundedPolicy,          // producer drops new frames while all slots are occupied
+        LatestPolicy            // producer replaces unread frame by the new one, consumer always takes the newest frame
+    };
+
+    explicit QFrameRing(quint16 length = DEFAULT_FRAME_RING_LENGTH);
+    ~QFrameRing();
+
+    Slot *writeSlot();      // producer side, returns free slot or NULL if ring is full (never NULL for LatestPolicy)
+    void commit();          // producer side, publishes slot obtained by writeSlot()
+    Slot *readSlot();       // consumer side, returns the oldest published slot or NULL if ring is empty
+    void release();         // consumer side, returns slot obtained by readSlot() back to producer
+    quint16 count() const;  // number of published but not yet released slots
+    quint16 length() const;
+
+    void setPolicy(Policy policy);  // can be called from any thread, takes effect when the producer has nothing pending in the other mode
+    Policy policy() const;
+    void countDropped();    // producer side, call it for each frame that was captured but not written
+    quint32 dropped() const;    // number of frames dropped by the producer
+    quint32 coalesced() const;  // number of frames that were replaced in the mailbox before the consumer took them
+
+private:
+    Slot *v_slots;          // m_length ring slots followed by MAILBOX_LENGTH mailbox slots
+    quint16 m_length;
+    QAtomicInt m_head;      // position of the next slot to write, changed only by producer, takes values in [0, 2*m_length)
+    QAtomicInt m_tail;      // position of the next slot to read, changed only by consumer, takes values in [0, 2*m_length)
+    QAtomicInt m_policy;    // requested policy
+    bool m_mailboxFlag;     // producer writes to the mailbox, changed only by producer
+    bool m_mailboxRead;     // consumer has taken the slot from the mailbox, changed only by consumer
+    QAtomicInt m_mailbox;   // index of the published mailbox slot, MAILBOX_FRESH bit is set until the consumer takes it
+    int m_back;             // mailbox slot owned by the producer
+    int m_front;            // mailbox slot owned by the consumer
+    QAtomicInt m_dropped;
+    QAtomicInt m_coalesced;
+};
+
+//------------------------------------------------------------------------------------------------------
+
+inline quint16 QFrameRing::count() const
+{
+    return (2*m_length + m_head.loadAcquire() - m_tail.loadAcquire()) % (2*m_length);
+}
+
+//------------------------------------------------------------------------------------------------------
+#endif // QFRAMERING_H
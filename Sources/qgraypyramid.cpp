@@ -0,0 +1,76 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QGrayPyramid holds grayscale levels of the current frame: full size, 1/2 and 1/4. QOpencvProcessor
+resets it on every frame with the full size image, lower levels and their histogram equalized copies are
+built on the first request and then shared read-only by every stage of the frame (cascade, tracker,
+custom processing), so no stage converts or resizes the frame again. Memory comes from QScratchArena.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qgraypyramid.h"
+
+//------------------------------------------------------------------------------------------------------
+
+QGrayPyramid::QGrayPyramid(QScratchArena *arena):
+    pt_arena(arena)
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QGrayPyramid::clear()
+{
+    v_gray[0].release(); // only the header, memory belongs to the frame
+    for(int i = 0; i < GRAY_PYRAMID_LEVELS; i++)
+    {
+        v_grayReady[i] = false;
+        v_equalizedReady[i] = false;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QGrayPyramid::isEmpty() const
+{
+    return !v_grayReady[0];
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QGrayPyramid::reset(const cv::Mat &gray)
+{
+    clear();
+    v_gray[0] = gray;
+    v_grayReady[0] = true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+const cv::Mat &QGrayPyramid::gray(int level)
+{
+    level = std::min(std::max(level, 0), GRAY_PYRAMID_LEVELS - 1);
+    if(!v_grayReady[level] && (level > 0)) // level 0 is empty till reset(...)
+    {
+        const cv::Mat &upper = gray(level - 1);
+        cv::Size size((upper.cols + 1) / 2, (upper.rows + 1) / 2);
+        v_gray[level] = pt_arena->mat(v_grayMemory[level], size, size, CV_8UC1);
+        cv::resize(upper, v_gray[level], size, 0, 0, cv::INTER_AREA); // 2x2 area average
+        v_grayReady[level] = true;
+    }
+    return v_gray[level];
+}
+
+//------------------------------------------------------------------------------------------------------
+
+const cv::Mat &QGrayPyramid::equalized(int level)
+{
+    level = std::min(std::max(level, 0), GRAY_PYRAMID_LEVELS - 1);
+    if(!v_equalizedReady[level] && !gray(level).empty())
+    {
+        const cv::Mat &source = gray(level);
+        v_equalized[level] = pt_arena->mat(v_equalizedMemory[level], source.size(), source.size(), CV_8UC1);
+        cv::equalizeHist(source, v_equalized[level]);
+        v_equalizedReady[level] = true;
+    }
+    return v_equalized[level];
+}
@@ -0,0 +1,51 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QGrayPyramid holds grayscale levels of the current frame: full size, 1/2 and 1/4. QOpencvProcessor
+resets it on every frame with the full size image, lower levels and their histogram equalized copies are
+built on the first request and then shared read-only by every stage of the frame (cascade, tracker,
+custom processing), so no stage converts or resizes the frame again. Memory comes from QScratchArena.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QGRAYPYRAMID_H
+#define QGRAYPYRAMID_H
+//------------------------------------------------------------------------------------------------------
+
+#include <opencv2/opencv.hpp>
+
+#include "qscratcharena.h"
+
+#define GRAY_PYRAMID_LEVELS 3 // full size, 1/2 and 1/4
+
+//------------------------------------------------------------------------------------------------------
+
+class QGrayPyramid
+{
+public:
+    explicit QGrayPyramid(QScratchArena *arena);
+
+    void clear();                               // the next frame has come, levels of the previous one should not be used
+    bool isEmpty() const;                       // true if reset(...) was not called for the current frame
+    void reset(const cv::Mat &gray);            // full size level, it is not copied, so it should not change till clear()
+    const cv::Mat &gray(int level);             // level 0 - full size, 1 - 1/2, 2 - 1/4, each level is the area average of the previous one
+    const cv::Mat &equalized(int level);        // histogram equalized copy of gray(level)
+    static double scale(int level);             // size of the level relative to the full size
+
+private:
+    QScratchArena *pt_arena;
+    cv::Mat v_gray[GRAY_PYRAMID_LEVELS];
+    cv::Mat v_equalized[GRAY_PYRAMID_LEVELS];
+    cv::Mat v_grayMemory[GRAY_PYRAMID_LEVELS];      // level 0 is not used, full size image is not copied
+    cv::Mat v_equalizedMemory[GRAY_PYRAMID_LEVELS];
+    bool v_grayReady[GRAY_PYRAMID_LEVELS];
+    bool v_equalizedReady[GRAY_PYRAMID_LEVELS];
+};
+
+//------------------------------------------------------------------------------------------------------
+
+inline double QGrayPyramid::scale(int level)
+{
+    return 1.0 / (1 << level);
+}
+
+//------------------------------------------------------------------------------------------------------
+#endif // QGRAYPYRAMID_H
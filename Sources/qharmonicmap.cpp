@@ -11,7 +11,6 @@ QHarmonicProcessorMap::QHarmonicProcessorMap(QObject *parent, quint32 width, qui
     m_updations(0),
     m_min(DEFAULT_MIN),
     m_max(DEFAULT_MAX),
-    m_cell(0),
     m_type(VPGMap)
 {
     v_map = new qreal[m_length]; // 0...width*height-1
@@ -53,15 +52,16 @@ QHarmonicProcessorMap::~QHarmonicProcessorMap()
     delete[] v_threads;
 }
 
-void QHarmonicProcessorMap::updateHarmonicProcessor(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double period)
+void QHarmonicProcessorMap::updateHarmonicProcessors(const QMapFrame &frame)
 {
-    v_processors[m_cell].EnrollData(red,green,blue,area,period);
-    /*
-      connect(this, SIGNAL(dataArrived(ulong,ulong,ulong,ulong,double)), &v_processors[m_cell], SLOT(EnrollData(ulong,ulong,ulong,ulong,double)));
-      emit dataArrived(red,green,blue,area,period);
-      disconnect(this, SIGNAL(dataArrived(ulong,ulong,ulong,ulong,double)), &v_processors[m_cell], SLOT(EnrollData(ulong,ulong,ulong,ulong,double)));
-    */
-    m_cell = (++m_cell) % m_length;
+    const QMapCell *cells = frame.cells.constData();
+    for(int i = 0; i < frame.cells.size(); i++)
+    {
+        if(cells[i].id < m_length)
+        {
+            v_processors[cells[i].id].EnrollData(cells[i].red, cells[i].green, cells[i].blue, cells[i].area, frame.timestamp);
+        }
+    }
 }
 
 void QHarmonicProcessorMap::updateCell(quint32 id, qreal value)
@@ -5,6 +5,7 @@
 #include <QThread>
 
 #include "qharmonicprocessor.h"
+#include "qmapframe.h"
 
 class QHarmonicProcessorMap: public QObject
 {
@@ -18,13 +19,13 @@ public:
 signals:
     void updateMap();
     void mapUpdated(const qreal *pointer, quint32 width, quint32 height, qreal max, qreal min);
-    void dataArrived(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double period);
+    void dataArrived(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double timestamp);
     void changeColorChannel(int value);
     void updatePCAMode(bool value);
     void setEstimationInterval(int value);
 
 public slots:
-    void updateHarmonicProcessor(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double period);
+    void updateHarmonicProcessors(const QMapFrame &frame); // enrolls sums of all cells of the frame, cells with unknown id are ignored
     void setMapType(MapType type_id, bool snrControl);
 
 private:
@@ -39,7 +40,6 @@ private:
     quint32 m_updations;
     qreal m_min;
     qreal m_max;
-    quint32 m_cell;
     quint16 m_threadCount;
     MapType m_type;
 
@@ -28,7 +28,8 @@ QHarmonicProcessor::QHarmonicProcessor(QObject *parent, quint16 length_of_data,
     m_BreathCurpos(0),
     m_BreathAverageInterval(DEFAULT_BREATH_AVERAGE),
     m_BreathCNInterval(DEFAULT_BREATH_NORMALIZATION_INTERVAL),
-    m_pruningFlag(false)
+    m_pruningFlag(false),
+    m_lastTimestamp(-1.0)
 {
     // Memory allocation
     v_RawCh1 = new qreal[m_DataLength];
@@ -110,8 +111,14 @@ QHarmonicProcessor::~QHarmonicProcessor()
 
 //----------------------------------------------------------------------------------------------------------
 
-void QHarmonicProcessor::EnrollData(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double time)
+void QHarmonicProcessor::EnrollData(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double timestamp)
 {
+    qreal time = timestamp - m_lastTimestamp; // interval between the counts on the capture clock, it does not depend on processing delays
+    if((m_lastTimestamp < 0.0) || (time <= 0.0))
+    {
+        time = v_HeartTime[loop(curpos - 1)];
+    }
+    m_lastTimestamp = timestamp;
 
     const quint16 pos = loopBuffer(curpos);   //a variable for position storing
 
@@ -428,6 +435,7 @@ void QHarmonicProcessor::computeHeartRate()
     if(m_HeartSNR > SNR_TRESHOLD)
     {
         m_HeartRate = (power_multiplyed_by_index / signal_power) * 60000.0 / buffer_duration;
+        emit heartRateMeasured(m_ID, m_HeartRate, m_HeartSNR);
         if((m_HeartRate <= m_rightTreshold) && (m_HeartRate >= m_leftThreshold))
             emit heartRateUpdated(m_HeartRate, m_HeartSNR, true);
         else
@@ -50,6 +50,7 @@ signals:
     void svpgUpdated(quint32 id, qreal value);  // signal for mapping
     void bvpgUpdated(quint32 id, qreal value);  // signal for mapping
     void amplitudeUpdated(quint32 id, qreal value); // signal for mapping
+    void heartRateMeasured(quint32 id, qreal freq_value, qreal snr_value); // signal for regions, is emitted with heartRateUpdated(...)
 
     void breathSignalUpdated(const qreal *pointer, quint16 length);
     void breathSpectrumUpdated(const qreal *pointer, quint16 length);
@@ -59,7 +60,7 @@ signals:
     void measurementsUpdated(qreal heart_rate, qreal heart_snr, qreal breath_rate, qreal breath_snr);
 
 public slots:
-    void EnrollData(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double time);
+    void EnrollData(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double timestamp); // timestamp is the capture time of the frame in ms, intervals between counts are evaluated from it
     void computeHeartRate(); // use FFT algorithm for HeartRate evaluation
     void computeBreathRate();
     void CountFrequency(); // use simple count algorithm on v_BinaryOutput for HeartRate evaluation
@@ -138,6 +139,7 @@ private:
     qreal m_BreathSNR;
 
     bool m_pruningFlag;
+    double m_lastTimestamp; // capture timestamp of the previous count, in ms, negative before the first count
 };
 
 // inline, for speed, must therefore reside in header file
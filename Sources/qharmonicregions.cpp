@@ -0,0 +1,110 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QHarmonicRegions feeds the sums of every face sub-region (see QFaceRegions) to its own QHarmonicProcessor
+and, on each estimation, selects the region with the best heart SNR. Processors are children of the
+object, so they live in its thread and are called directly, without queued signals per region.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qharmonicregions.h"
+
+//------------------------------------------------------------------------------------------------------
+
+QHarmonicRegions::QHarmonicRegions(QObject *parent, quint16 length_of_data, quint16 length_of_buffer) :
+    QObject(parent),
+    m_enrolledFrames(0)
+{
+    for(quint32 i = 0; i < FACE_REGIONS; i++)
+    {
+        v_processors[i] = new QHarmonicProcessor(this, length_of_data, length_of_buffer);
+        v_processors[i]->setID(i); // id of the region, it comes back with snrUpdated(...) and heartRateMeasured(...)
+        connect(v_processors[i], SIGNAL(snrUpdated(quint32,qreal)), this, SLOT(updateSnr(quint32,qreal)));
+        connect(v_processors[i], SIGNAL(heartRateMeasured(quint32,qreal,qreal)), this, SLOT(updateRate(quint32,qreal,qreal)));
+        v_rates[i] = 0.0;
+        v_snr[i] = 0.0;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QHarmonicRegions::updateHarmonicProcessors(const QMapFrame &frame)
+{
+    const QMapCell *cells = frame.cells.constData();
+    for(int i = 0; i < frame.cells.size(); i++)
+    {
+        if((cells[i].id < FACE_REGIONS) && (cells[i].area > 0))
+        {
+            v_processors[cells[i].id]->EnrollData(cells[i].red, cells[i].green, cells[i].blue, cells[i].area, frame.timestamp);
+        }
+    }
+    m_enrolledFrames++;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QHarmonicRegions::computeHeartRates()
+{
+    if(m_enrolledFrames == 0)
+    {
+        return;
+    }
+    m_enrolledFrames = 0;
+    int best = -1;
+    for(quint32 i = 0; i < FACE_REGIONS; i++)
+    {
+        v_rates[i] = 0.0;
+        v_processors[i]->computeHeartRate(); // updateSnr(...) and updateRate(...) are called from here
+        if((v_rates[i] > 0.0) && ((best < 0) || (v_snr[i] > v_snr[best])))
+        {
+            best = i;
+        }
+    }
+    if(best < 0)
+    {
+        emit regionsTooNoisy();
+    }
+    else
+    {
+        emit regionSelected(best, v_rates[best], v_snr[best]);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QHarmonicRegions::switchColorMode(int value)
+{
+    for(quint32 i = 0; i < FACE_REGIONS; i++)
+    {
+        v_processors[i]->switchColorMode(value);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QHarmonicRegions::setPCAMode(bool value)
+{
+    for(quint32 i = 0; i < FACE_REGIONS; i++)
+    {
+        v_processors[i]->setPCAMode(value);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QHarmonicRegions::updateSnr(quint32 id, qreal value)
+{
+    if(id < FACE_REGIONS)
+    {
+        v_snr[id] = value;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QHarmonicRegions::updateRate(quint32 id, qreal heart_rate, qreal snr_value)
+{
+    if(id < FACE_REGIONS)
+    {
+        v_rates[id] = heart_rate;
+        v_snr[id] = snr_value;
+    }
+}
@@ -0,0 +1,48 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QHarmonicRegions feeds the sums of every face sub-region (see QFaceRegions) to its own QHarmonicProcessor
+and, on each estimation, selects the region with the best heart SNR. Processors are children of the
+object, so they live in its thread and are called directly, without queued signals per region.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QHARMONICREGIONS_H
+#define QHARMONICREGIONS_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QObject>
+
+#include "qharmonicprocessor.h"
+#include "qmapframe.h"
+#include "qfaceregions.h"
+
+//------------------------------------------------------------------------------------------------------
+
+class QHarmonicRegions : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QHarmonicRegions(QObject *parent = NULL, quint16 length_of_data = 256, quint16 length_of_buffer = 256);
+
+signals:
+    void regionSelected(quint32 id, qreal heart_rate, qreal snr_value); // region with the best SNR among the regions that have measured heart rate
+    void regionsTooNoisy();                                             // no region has SNR above SNR_TRESHOLD
+
+public slots:
+    void updateHarmonicProcessors(const QMapFrame &frame); // enrolls sums of all regions of the frame, cells with unknown id are ignored
+    void computeHeartRates();                              // does nothing if no frame has been enrolled since the last call
+    void switchColorMode(int value);
+    void setPCAMode(bool value);
+
+private:
+    QHarmonicProcessor *v_processors[FACE_REGIONS];
+    qreal v_rates[FACE_REGIONS];    // heart rate of the last estimation, 0 if the region is too noisy
+    qreal v_snr[FACE_REGIONS];
+    quint32 m_enrolledFrames;
+
+private slots:
+    void updateSnr(quint32 id, qreal value);
+    void updateRate(quint32 id, qreal heart_rate, qreal snr_value);
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QHARMONICREGIONS_H
@@ -24,6 +24,7 @@ QImageWidget::QImageWidget(QWidget *parent): WIDGET_CLASS(parent)
     m_drawDataFlag = false;
     v_map = NULL;
     m_imageFlag = true;
+    m_overlay.marks = QRoiOverlay::NoMarks;
     m_opacity = DEFAULT_OPACITY;
     computeColorTable();
 }
@@ -80,7 +81,7 @@ void QImageWidget::updateImage(const cv::Mat& image, qreal frame_period, quint32
 {
     m_informationString = QString::number(frame_period, 'f', 1) + tr(" ms, ")
                           + QString::number(image.cols) + "x" + QString::number(image.rows) + " / "
-                          + QString::number(pixels_enrolled);
+                          + QString::number(pixels_enrolled) + m_stagesString + m_readAheadString + m_queueString + m_samplingString + m_regionString;
 
     switch ( image.type() )
     {
@@ -92,13 +93,72 @@ void QImageWidget::updateImage(const cv::Mat& image, qreal frame_period, quint32
             cv::cvtColor(image, opencv_image, CV_BGR2RGB);
             break;
     }
+    if(m_imageFlag)
+    {
+        composeOverlay(image.channels()); // the frame itself is not changed, it can be used by other consumers
+    }
+    m_overlay.runs = QVector<QRoiRun>(); // releases the runs, so the processor reuses their memory for the next frame
+    m_overlay.marks = QRoiOverlay::NoMarks;
+    m_overlay.outline = cv::Rect();
     assert(opencv_image.isContinuous()); // QImage needs the data to be stored continuously in memory
-    qt_image = QImage(opencv_image.data, opencv_image.cols, opencv_image.rows, opencv_image.cols * 3, QImage::Format_RGB888);  // Assign OpenCV's image buffer to the QImage
+    if((qt_image.constBits() != opencv_image.data) || (qt_image.width() != opencv_image.cols) || (qt_image.height() != opencv_image.rows))
+    {
+        qt_image = QImage(opencv_image.data, opencv_image.cols, opencv_image.rows, opencv_image.cols * 3, QImage::Format_RGB888);  // Assign OpenCV's image buffer to the QImage
+    }
+    else
+    {
+        qt_image.bits(); // opencv_image memory is reused, bits() does not copy it but tells the paint engine caches that the content is new
+    }
     update();
 }
 
 //------------------------------------------------------------------------------------
 
+void QImageWidget::updateOverlay(const QRoiOverlay &overlay)
+{
+    m_overlay = overlay;
+}
+
+//------------------------------------------------------------------------------------
+
+void QImageWidget::composeOverlay(int channels)
+{
+    // opencv_image is RGB, so red is channel 0 and blue is channel 2, grayscale frame is copied to all channels
+    for(int k = 0; k < m_overlay.runs.size(); k++)
+    {
+        const QRoiRun &run = m_overlay.runs.at(k);
+        if((run.row < 0) || (run.row >= opencv_image.rows))
+            continue;
+        unsigned char *p = opencv_image.ptr(run.row);
+        int end = qMin(run.end, opencv_image.cols);
+        for(int i = qMax(run.start, 0); i < end; i++)
+        {
+            if(channels == 1)
+            {
+                p[3*i] &= OVERLAY_MARK_MASK;
+                p[3*i+1] &= OVERLAY_MARK_MASK;
+                p[3*i+2] &= OVERLAY_MARK_MASK;
+                continue;
+            }
+            if(m_overlay.marks & QRoiOverlay::MarkRed)
+            {
+                p[3*i] &= OVERLAY_MARK_MASK;
+            }
+            if(m_overlay.marks & QRoiOverlay::MarkBlue)
+            {
+                p[3*i+2] &= OVERLAY_MARK_MASK;
+            }
+        }
+    }
+    if(m_overlay.outline.area() > 0)
+    {
+        const cv::Scalar &color = m_overlay.outlineColor;
+        cv::rectangle(opencv_image, m_overlay.outline, (channels == 1) ? cv::Scalar::all(color[0]) : cv::Scalar(color[2], color[1], color[0]));
+    }
+}
+
+//------------------------------------------------------------------------------------
+
 void QImageWidget::paintEvent(QPaintEvent* )
 {
     QPainter painter( this );
@@ -528,3 +588,54 @@ void QImageWidget::setImageFlag(bool value)
         m_opacity = 156;
     computeColorTable();
 }
+//----------------------------------------------------------------------------------
+void QImageWidget::updateStagesTime(qreal capture_time, qreal processing_time)
+{
+    m_stagesString = tr(" (capture ") + QString::number(capture_time, 'f', 1) + tr(" ms, processing ")
+                     + QString::number(processing_time, 'f', 1) + tr(" ms)");
+}
+
+//-----------------------------------------------------------------------------------
+
+void QImageWidget::updateQueueStatus(quint32 dropped, quint32 coalesced)
+{
+    if((dropped > 0) || (coalesced > 0))
+    {
+        m_queueString = tr(", dropped ") + QString::number(dropped) + tr(", coalesced ") + QString::number(coalesced);
+    }
+}
+
+//-----------------------------------------------------------------------------------
+
+void QImageWidget::updateReadAheadDepth(quint16 frames)
+{
+    m_readAheadString = tr(", decoded ahead ") + QString::number(frames);
+}
+
+//-----------------------------------------------------------------------------------
+
+void QImageWidget::updateRegionString(quint32 id, qreal heart_rate, qreal snr_value)
+{
+    m_regionString = ", " + tr(QFaceRegions::name(id)) + " " + QString::number(heart_rate, 'f', 0) + tr(" bpm, SNR ") + QString::number(snr_value, 'f', 2) + tr(" dB");
+}
+
+//-----------------------------------------------------------------------------------
+
+void QImageWidget::clearRegionString()
+{
+    m_regionString.clear();
+}
+
+//-----------------------------------------------------------------------------------
+
+void QImageWidget::updateSamplingError(qreal error)
+{
+    if(error > 0.0)
+    {
+        m_samplingString = tr(", sampling error ") + QString::number(error, 'f', 3);
+    }
+    else
+    {
+        m_samplingString.clear();
+    }
+}
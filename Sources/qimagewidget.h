@@ -15,6 +15,9 @@ QImage instance from cv::Mat image. The QImageWidget should be used as widget fo
 #include <QMouseEvent>
 #include <opencv2/opencv.hpp>
 
+#include "qroioverlay.h"
+#include "qfaceregions.h"
+
 #ifdef REPLACE_WIDGET_TO_OPENGLWIDGET
     #include <QOpenGLWidget>
     #include <QSurfaceFormat>
@@ -39,6 +42,7 @@ signals:
 
 public slots:
     void updateImage(const cv::Mat &image, qreal frame_period, quint32 pixels_enrolled); // takes cv::Mat image and converts it to the appropriate Qt QImage format
+    void updateOverlay(const QRoiOverlay &overlay); // takes highlight of the next image, updateImage(...) composites it only while the image is shown
     void updatePointer(const qreal *pointer, quint16 length);  // updates pointer to data;
     void updateValues(qreal value1, qreal value2, bool flag); // use to update strings
     void updateBreathStrings(qreal breath_rate, qreal snr_value);
@@ -53,6 +57,12 @@ public slots:
     void selectWholeImage();
     void clearMap();
     void setImageFlag(bool value);
+    void updateStagesTime(qreal capture_time, qreal processing_time); // use to show how long frame capture and frame processing stages take
+    void updateQueueStatus(quint32 dropped, quint32 coalesced);       // use to show how many frames were lost between capture and processing
+    void updateReadAheadDepth(quint16 frames);                        // use to show how many decoded frames are waiting, 0 most of the time means decode-bound run
+    void updateSamplingError(qreal error);                            // use to show the error of the mean caused by the sample stride, 0 hides it
+    void updateRegionString(quint32 id, qreal heart_rate, qreal snr_value); // use to show the face sub-region with the best SNR, see QFaceRegions
+    void clearRegionString();
 
 protected:
     void paintEvent(QPaintEvent*);
@@ -63,8 +73,14 @@ protected:
 private:
     QImage qt_image;        // stores current QImage instance
     cv::Mat opencv_image;   // stores current cv::Mat instance
+    QRoiOverlay m_overlay;  // stores highlight of the next image
     QRect m_aimrect;        // stores current rectangle region on widget
     QString m_informationString;    // stores text information that will be drawn on the widget in paintEvent
+    QString m_stagesString;         // stores capture and processing stages time, it is appended to m_informationString
+    QString m_queueString;          // stores dropped and coalesced frames counts, it is appended to m_informationString
+    QString m_readAheadString;      // stores read-ahead queue depth, it is appended to m_informationString
+    QString m_samplingString;       // stores sampling error, it is appended to m_informationString
+    QString m_regionString;         // stores the best face sub-region, it is appended to m_informationString
     QString m_frequencyString;  // stores frequency
     QString m_snrString;    // stores SNR string value
     QString m_breathRateString;  // stores frequency
@@ -102,6 +118,7 @@ private slots:
     void drawStrings(QPainter &painter, const QRect &input_rect); // use this eunction inside paintEvent(...) handler to draw string on the image
     void drawData(QPainter &painter, const QRect &input_rect);   // draws pt_Data[] if ptData != NULL and drops pt_Data to NULL on every function call
     void drawMap(QPainter &painter, const QRect &input_rect);
+    void composeOverlay(int channels); // draws m_overlay on opencv_image, channels is the number of channels of the original frame
 };
 
 //------------------------------------------------------------------------------------------------------
@@ -0,0 +1,32 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QMapFrame carries the sums of all map cells of one frame from QOpencvProcessor::mapProcess(...) to
+QHarmonicProcessorMap in a single signal. Cells are identified explicitly by id (row-major index of the
+cell in the map), cell array is implicitly shared, so a queued signal does not copy it.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QMAPFRAME_H
+#define QMAPFRAME_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QVector>
+
+//------------------------------------------------------------------------------------------------------
+
+struct QMapCell
+{
+    quint32 id;
+    unsigned long red;
+    unsigned long green;
+    unsigned long blue;
+    unsigned long area;
+};
+
+struct QMapFrame
+{
+    QVector<QMapCell> cells;
+    double timestamp;       // capture time of the frame in ms
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QMAPFRAME_H
@@ -0,0 +1,320 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QMappedVideo reads uncompressed video files through memory mapping. Supported formats:
+- YUV4MPEG2 (*.y4m) with 4:2:0 or mono colorspace;
+- raw BGR24 (*.bgr), frame size and rate are taken from the file name, e.g. clip_640x480_30fps.bgr.
+Raw BGR24 and mono frames are returned as cv::Mat headers that point straight into the mapping, the
+mapping is private, so in-place processing of a frame does not change the file on disk. Y4M 4:2:0
+frames are converted to BGR unless native YUV is enabled, then they are returned as I420 headers too.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qmappedvideo.h"
+#include <QFileInfo>
+#include <QByteArray>
+#include <QList>
+#include <QRegExp>
+
+#define Y4M_MAX_HEADER_LENGTH 1024
+
+//------------------------------------------------------------------------------------------------------
+
+QMappedVideo::QMappedVideo():
+    pt_file(NULL),
+    pt_retiredFile(NULL),
+    pt_data(NULL),
+    m_dataSize(0),
+    m_format(Unknown),
+    m_width(0),
+    m_height(0),
+    m_fps(DEFAULT_RAW_VIDEO_FPS),
+    m_firstFrame(0),
+    m_frameSize(0),
+    m_frameStep(0),
+    m_frameCount(0),
+    m_position(0),
+    m_nativeYUVFlag(false)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QMappedVideo::~QMappedVideo()
+{
+    delete pt_retiredFile; // QFile unmaps all its mappings on close
+    delete pt_file;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::isSupported(const QString &filename)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    return (suffix == "y4m") || (suffix == "bgr");
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::open(const QString &filename)
+{
+    close();
+    delete pt_retiredFile;
+    pt_retiredFile = pt_file;
+    pt_file = new QFile(filename);
+    if(!pt_file->open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    m_dataSize = pt_file->size();
+    pt_data = pt_file->map(0, m_dataSize, QFileDevice::MapPrivateOption); // private mapping is copy-on-write
+    if(pt_data == NULL)
+    {
+        qWarning("QMappedVideo: can not map %s", filename.toLocal8Bit().constData());
+        return false;
+    }
+
+    bool result;
+    if(QFileInfo(filename).suffix().toLower() == "y4m")
+    {
+        result = parseY4MHeader();
+    }
+    else
+    {
+        result = parseRawName(filename);
+    }
+    if(!result || (m_frameCount <= 0))
+    {
+        close();
+        return false;
+    }
+    m_position = 0;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QMappedVideo::close()
+{
+    pt_data = NULL; // the mapping itself lives till the next open(), see pt_retiredFile
+    m_format = Unknown;
+    m_frameCount = 0;
+    m_position = 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::isOpened() const
+{
+    return pt_data != NULL;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::read(cv::Mat &frame)
+{
+    if((pt_data == NULL) || (m_position >= m_frameCount))
+    {
+        return false;
+    }
+    uchar *ptr = pt_data + m_firstFrame + m_position * m_frameStep;
+    switch(m_format)
+    {
+        case RawBGR24:
+            frame = cv::Mat(m_height, m_width, CV_8UC3, ptr); // only the header is created
+            break;
+        case Y4MMono:
+            frame = cv::Mat(m_height, m_width, CV_8UC1, ptr);
+            break;
+        case Y4M420:
+            if(m_nativeYUVFlag)
+            {
+                frame = cv::Mat(m_height + m_height/2, m_width, CV_8UC1, ptr);
+                break;
+            }
+            if(frame.refcount == NULL)
+            {
+                frame.release(); // frame points into a mapping, it should not be overwritten
+            }
+            cv::cvtColor(cv::Mat(m_height + m_height/2, m_width, CV_8UC1, ptr), frame, CV_YUV2BGR_I420);
+            break;
+        default:
+            return false;
+    }
+    m_position++;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::seek(int number)
+{
+    if((number >= 0) && (number <= m_frameCount))
+    {
+        m_position = number;
+        return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QMappedVideo::position() const
+{
+    return m_position;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QMappedVideo::frameCount() const
+{
+    return m_frameCount;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+double QMappedVideo::fps() const
+{
+    return m_fps;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+double QMappedVideo::timestamp() const
+{
+    return (m_position - 1) * 1000.0 / m_fps;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QMappedVideo::Format QMappedVideo::format() const
+{
+    return m_format;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QMappedVideo::setNativeYUV(bool value)
+{
+    m_nativeYUVFlag = value;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::isNativeYUV() const
+{
+    return m_nativeYUVFlag && (m_format == Y4M420);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::parseY4MHeader()
+{
+    qint64 length = 0;
+    while((length < m_dataSize) && (length < Y4M_MAX_HEADER_LENGTH) && (pt_data[length] != '\n'))
+    {
+        length++;
+    }
+    if((length == m_dataSize) || (length == Y4M_MAX_HEADER_LENGTH))
+    {
+        return false;
+    }
+
+    QList<QByteArray> tokens = QByteArray((const char*)pt_data, length).split(' ');
+    if(tokens.isEmpty() || (tokens.at(0) != "YUV4MPEG2"))
+    {
+        return false;
+    }
+    m_format = Y4M420; // 4:2:0 is default colorspace for Y4M
+    m_fps = DEFAULT_RAW_VIDEO_FPS;
+    m_width = 0;
+    m_height = 0;
+    for(int i = 1; i < tokens.size(); i++)
+    {
+        const QByteArray &token = tokens.at(i);
+        if(token.isEmpty())
+            continue;
+        QByteArray value = token.mid(1);
+        switch(token.at(0))
+        {
+            case 'W':
+                m_width = value.toInt();
+                break;
+            case 'H':
+                m_height = value.toInt();
+                break;
+            case 'F':
+                if(value.split(':').size() == 2 && value.split(':').at(1).toDouble() > 0.0)
+                {
+                    m_fps = value.split(':').at(0).toDouble() / value.split(':').at(1).toDouble();
+                }
+                break;
+            case 'C':
+                if(value.startsWith("420"))
+                {
+                    m_format = Y4M420;
+                }
+                else if(value == "mono")
+                {
+                    m_format = Y4MMono;
+                }
+                else
+                {
+                    qWarning("QMappedVideo: Y4M colorspace %s is not supported", value.constData());
+                    return false;
+                }
+                break;
+        }
+    }
+    if((m_width <= 0) || (m_height <= 0) || (m_fps <= 0.0) || ((m_format == Y4M420) && ((m_width % 2) || (m_height % 2))))
+    {
+        return false;
+    }
+
+    qint64 frameHeader = length + 1; // frame header is "FRAME" with optional parameters and '\n', its length is supposed to be the same for all frames
+    qint64 frameHeaderLength = 0;
+    while((frameHeader + frameHeaderLength < m_dataSize) && (frameHeaderLength < Y4M_MAX_HEADER_LENGTH) && (pt_data[frameHeader + frameHeaderLength] != '\n'))
+    {
+        frameHeaderLength++;
+    }
+    if((frameHeaderLength < 5) || (qstrncmp((const char*)pt_data + frameHeader, "FRAME", 5) != 0))
+    {
+        return false;
+    }
+    frameHeaderLength++; // '\n'
+
+    m_frameSize = (m_format == Y4M420) ? (qint64)m_width * m_height * 3 / 2 : (qint64)m_width * m_height;
+    m_firstFrame = frameHeader + frameHeaderLength;
+    m_frameStep = frameHeaderLength + m_frameSize;
+    m_frameCount = (m_dataSize - frameHeader) / m_frameStep;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QMappedVideo::parseRawName(const QString &filename)
+{
+    QString name = QFileInfo(filename).completeBaseName();
+    QRegExp sizeExp("(\\d+)x(\\d+)");
+    if(sizeExp.indexIn(name) < 0)
+    {
+        qWarning("QMappedVideo: frame size should be specified in the name of raw file, e.g. clip_640x480_30fps.bgr");
+        return false;
+    }
+    m_width = sizeExp.cap(1).toInt();
+    m_height = sizeExp.cap(2).toInt();
+    m_fps = DEFAULT_RAW_VIDEO_FPS;
+    QRegExp fpsExp("(\\d+(\\.\\d+)?)fps", Qt::CaseInsensitive);
+    if(fpsExp.indexIn(name) >= 0)
+    {
+        m_fps = fpsExp.cap(1).toDouble();
+    }
+    if((m_width <= 0) || (m_height <= 0) || (m_fps <= 0.0))
+    {
+        return false;
+    }
+    m_format = RawBGR24;
+    m_frameSize = (qint64)m_width * m_height * 3;
+    m_firstFrame = 0;
+    m_frameStep = m_frameSize;
+    m_frameCount = m_dataSize / m_frameStep;
+    return true;
+}
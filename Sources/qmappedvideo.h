@@ -0,0 +1,66 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QMappedVideo reads uncompressed video files through memory mapping. Supported formats:
+- YUV4MPEG2 (*.y4m) with 4:2:0 or mono colorspace;
+- raw BGR24 (*.bgr), frame size and rate are taken from the file name, e.g. clip_640x480_30fps.bgr.
+Raw BGR24 and mono frames are returned as cv::Mat headers that point straight into the mapping, the
+mapping is private, so in-place processing of a frame does not change the file on disk. Y4M 4:2:0
+frames are converted to BGR unless native YUV is enabled, then they are returned as I420 headers too.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QMAPPEDVIDEO_H
+#define QMAPPEDVIDEO_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QFile>
+#include <QString>
+#include <opencv2/opencv.hpp>
+
+#define DEFAULT_RAW_VIDEO_FPS 30.0
+
+//------------------------------------------------------------------------------------------------------
+
+class QMappedVideo
+{
+public:
+    enum Format { Unknown, RawBGR24, Y4M420, Y4MMono };
+
+    QMappedVideo();
+    ~QMappedVideo();
+
+    bool open(const QString &filename);
+    void close();
+    bool isOpened() const;
+    bool read(cv::Mat &frame);      // returns the next frame, see the header comment about memory ownership
+    bool seek(int number);          // sets the number of the next frame
+    int position() const;           // returns the number of the next frame
+    int frameCount() const;
+    double fps() const;
+    double timestamp() const;       // returns timestamp of the last read frame, in ms
+    Format format() const;
+    void setNativeYUV(bool value);  // if true, Y4M 4:2:0 frames are returned without conversion
+    bool isNativeYUV() const;       // returns true if read() returns I420 frames
+    static bool isSupported(const QString &filename);
+
+private:
+    QFile *pt_file;         // file that is mapped now
+    QFile *pt_retiredFile;  // previously mapped file, it is unmapped on the next open() because frames from it can still wait for processing
+    uchar *pt_data;         // a pointer to the mapped file
+    qint64 m_dataSize;
+    Format m_format;
+    int m_width;
+    int m_height;
+    double m_fps;
+    qint64 m_firstFrame;    // offset of the first frame data from the beginning of the file
+    qint64 m_frameSize;     // size of a frame data in bytes
+    qint64 m_frameStep;     // distance between the beginnings of the neighbour frames in bytes (includes Y4M frame header)
+    int m_frameCount;
+    int m_position;
+    bool m_nativeYUVFlag;
+
+    bool parseY4MHeader();
+    bool parseRawName(const QString &filename);
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QMAPPEDVIDEO_H
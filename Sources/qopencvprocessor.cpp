@@ -5,29 +5,90 @@ The simplest way to use it - rewrite appropriate section in QOpencvProcessor::cu
 ------------------------------------------------------------------------------------------------------*/
 
 #include "qopencvprocessor.h"
+#include "qroikernels.h"
 
 #define OBJECT_MINSIZE 128
-#define LEVEL_SHIFT 32
+#define DETECTION_LEVEL 1        // level of QGrayPyramid for the cascade in face tracking and asynchronous detection modes
+#define DETECTION_SCALE QGrayPyramid::scale(DETECTION_LEVEL)
+#define TRACK_MARGIN_DIVIDER 4  // face is searched in the window enlarged by 1/4 of the face size at every side
+#define TRACK_MIN_SCORE 0.6     // correlation below this value means that the track is lost
+#define SKIN_BOX_MARGIN_DIVIDER 4   // rectProcess(...) scans the skin box enlarged by 1/4 of its size at every side
+#define SKIN_RESCAN_PERIOD 30       // frames between full scans of the selected region in skin mode
+#define SKIN_COLLAPSE_RATIO 0.5     // full scan is made on the next frame if enrolled area falls below this part of the previous one
+
+//------------------------------------------------------------------------------------------------------
+
+class MapBandsBody : public cv::ParallelLoopBody
+{
+public:
+    MapBandsBody(QOpencvProcessor *processor, const cv::Mat &input, int stepsX):
+        pt_processor(processor),
+        m_input(input),
+        m_stepsX(stepsX)
+    {
+    }
+
+    void operator()(const cv::Range &range) const
+    {
+        pt_processor->accumulateMapBands(m_input, range, m_stepsX);
+    }
+
+private:
+    QOpencvProcessor *pt_processor;
+    cv::Mat m_input;
+    int m_stepsX;
+};
 
 
 //------------------------------------------------------------------------------------------------------
 
 QOpencvProcessor::QOpencvProcessor(QObject *parent):
-    QObject(parent)
+    QObject(parent),
+    m_grayPyramid(&m_scratch)
 {
     //Initialization
     m_cvRect.width = 0;
     m_cvRect.height = 0;
     m_framePeriod = 0.0;
+    m_timeCounter = cv::getTickCount();
+    m_frameTimestamp = 0.0;
+    m_lastTimestamp = -1.0;
+    m_timestampFlag = false;
+    m_pixelFormat = QFrameRing::BGRFormat;
     m_skinFlag = true;   
-    v_pixelSet = NULL;
+    m_mapCellSizeX = 1;
+    m_mapCellSizeY = 1;
+    pt_ring = NULL;
     m_seekCalibColors = false;
     m_calibFlag = false;
     m_blurSize = 4;
+    m_sampleStride = 1;
+    m_faceRegionsFlag = false;
     //------------
     m_emptyFrames = 0;
     m_facePos = 0;
+    m_detectionPeriod = 1;
+    m_framesSinceDetection = 0;
+    m_trackFlag = false;
+    pt_faceDetector = NULL;
+    pt_detectorThread = NULL;
     //------------
+    m_framesSinceRescan = 0;
+    m_skinArea = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+QOpencvProcessor::~QOpencvProcessor()
+{
+    setAsyncDetection(false);
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+quint32 QOpencvProcessor::scratchResizes() const
+{
+    return m_scratch.resizes();
 }
 
 //-----------------------------------------------------------------------------------------------------
@@ -47,24 +108,387 @@ void QOpencvProcessor::setMapRegion(const cv::Rect &input_rect)
 
 //-----------------------------------------------------------------------------------------------------
 
-void QOpencvProcessor::updateTime()
+void QOpencvProcessor::setFrameRing(QFrameRing *ring)
 {
-    m_timeCounter = cv::getTickCount();
+    pt_ring = ring;
+    m_lastTimestamp = -1.0; // timestamps of the other ring are not comparable
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::processQueuedFrames()
+{
+    if(pt_ring == NULL)
+        return;
+
+    QFrameRing::Slot *slot;
+    quint32 released = 0;
+    while( (slot = pt_ring->readSlot()) != NULL )
+    {
+        int64 startTime = cv::getTickCount();
+        m_frameTimestamp = slot->timestamp;
+        m_timestampFlag = true;
+        m_pixelFormat = slot->format;
+        quint32 resizes = m_scratch.resizes();
+        m_grayPyramid.clear(); // levels are built by the first stage that needs them
+        emit frameDequeued(slot->frame);
+        if(m_scratch.resizes() != resizes)
+        {
+            qWarning("QOpencvProcessor: scratch buffers are resized for %dx%d frames, %u resizes since start", slot->frame.cols, slot->frame.rows, m_scratch.resizes());
+        }
+        qreal processingTime = (cv::getTickCount() - startTime) * 1000.0 / cv::getTickFrequency();
+        emit stagesTimed(slot->captureTime, processingTime);
+        pt_ring->release(); // slot should not be used after this call, producer is free to overwrite it
+        released++;
+    }
+    m_timestampFlag = false;
+    m_pixelFormat = QFrameRing::BGRFormat;
+    m_grayPyramid.clear();
+    emit queueStatus(pt_ring->dropped(), pt_ring->coalesced());
+    if(released > 0)
+    {
+        emit slotsReleased();
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::updateFramePeriod()
+{
+    int64 ticks = cv::getTickCount();
+    double tickPeriod = (ticks - m_timeCounter) * 1000.0 / cv::getTickFrequency(); // result is calculated in milliseconds
+    m_timeCounter = ticks;
+    if(m_timestampFlag)
+    {
+        // the period of the capture does not depend on processing speed, so unthrottled files report their own frame rate
+        m_framePeriod = ((m_lastTimestamp >= 0.0) && (m_frameTimestamp > m_lastTimestamp)) ? m_frameTimestamp - m_lastTimestamp : tickPeriod;
+        m_lastTimestamp = m_frameTimestamp;
+    }
+    else
+    {
+        m_framePeriod = tickPeriod;
+        m_lastTimestamp = -1.0; // the sequence of capture timestamps is broken by the frame without one
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+cv::Size QOpencvProcessor::frameSize(const cv::Mat &input) const
+{
+    if(m_pixelFormat == QFrameRing::I420Format)
+    {
+        return cv::Size(input.cols, input.rows * 2 / 3);
+    }
+    return cv::Size(input.cols, input.rows);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+cv::Mat QOpencvProcessor::lumaPlane(const cv::Mat &input)
+{
+    switch(m_pixelFormat)
+    {
+        case QFrameRing::I420Format:
+            return input.rowRange(0, input.rows * 2 / 3);
+        case QFrameRing::YUYVFormat: {
+            cv::Mat luma = m_scratch.mat(m_lumaMemory, frameSize(input), frameSize(input), CV_8UC1);
+            cv::cvtColor(input, luma, CV_YUV2GRAY_YUY2);
+            return luma;
+        }
+        default:
+            return input;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QGrayPyramid &QOpencvProcessor::grayPyramid(const cv::Mat &input)
+{
+    if(m_grayPyramid.isEmpty())
+    {
+        if(m_pixelFormat == QFrameRing::BGRFormat)
+        {
+            cv::Size size = frameSize(input);
+            cv::Mat gray = m_scratch.mat(m_grayMemory, size, size, CV_8UC1);
+            cv::cvtColor(input, gray, CV_BGR2GRAY);
+            m_grayPyramid.reset(gray);
+        }
+        else
+        {
+            m_grayPyramid.reset(lumaPlane(input)); // luma is the grayscale image already
+        }
+    }
+    return m_grayPyramid;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+unsigned long QOpencvProcessor::accumulateYUV(const cv::Mat &input, const cv::Rect &rect, int flags, unsigned long &red, unsigned long &green, unsigned long &blue, unsigned long long *squares)
+{
+    cv::Size size = frameSize(input);
+    cv::Rect region = rect & cv::Rect(0, 0, size.width, size.height);
+
+    const unsigned char *pY;  // pointer to the luma of the row
+    const unsigned char *pU;  // pointer to the chroma of the row
+    const unsigned char *pV;
+    int stepY;          // distance between luma of the neighbour pixels
+    int stepUV;         // distance between chroma of the neighbour pixel pairs
+    int shiftY;         // column of the first luma value of pY
+    const int stride = (flags & SampledPixels) ? m_sampleStride : 1;
+    const bool smoothed = (flags & SmoothedPixels) && (region.area() > 0);
+    if(smoothed)
+    {
+        // chroma is subsampled already, only luma is smoothed, the frame is not changed, YUYV luma is converted once per frame by the pyramid
+        const cv::Mat &luma = (m_pixelFormat == QFrameRing::I420Format) ? lumaPlane(input) : grayPyramid(input).gray(0);
+        m_blurredLuma = m_scratch.mat(m_blurredLumaMemory, size, region.size(), CV_8UC1);
+        cv::blur(cv::Mat(luma, region), m_blurredLuma, cv::Size(m_blurSize, m_blurSize));
+    }
+    if(m_pixelFormat == QFrameRing::I420Format)
+    {
+        stepY = 1;
+        stepUV = 1;
+    }
+    else
+    {
+        stepY = smoothed ? 1 : 2; // blurred luma is a plane of its own
+        stepUV = 4;
+    }
+    shiftY = smoothed ? region.x : 0;
+
+    quint64 sumY = 0;
+    quint64 sumU = 0;
+    quint64 sumV = 0;
+    quint64 squaresY = 0;  // squares of luma above the black level
+    unsigned long area = 0;
+    unsigned char tempRed;
+    unsigned char tempGreen;
+    unsigned char tempBlue;
+    for(int j = region.y; j < region.y + region.height; j++)
+    {
+        if(m_pixelFormat == QFrameRing::I420Format)
+        {
+            pY = input.ptr(j);
+            pU = input.ptr(size.height) + (j/2)*(size.width/2); // chroma planes follow luma plane, I420 frames are always continuous
+            pV = pU + (size.width/2)*(size.height/2);
+        }
+        else
+        {
+            pY = input.ptr(j);
+            pU = pY + 1;
+            pV = pY + 3;
+        }
+        if(smoothed)
+        {
+            pY = m_blurredLuma.ptr(j - region.y);
+        }
+        int left = region.x;
+        int right = region.x + region.width;
+        if(flags & EllipsPixels) // spans are prepared by updateEllipsSpans(...) for the same region
+        {
+            left = v_ellipsSpans[j - region.y].start;
+            right = v_ellipsSpans[j - region.y].end;
+        }
+        int runStart = -1; // first column of the current run of enrolled pixels
+        int first = left + (stride - (left + j*(stride/2)) % stride) % stride; // the same sampling pattern as QRoiKernels::accumulateBlurred(...) uses
+        for(int i = first; i < right; i += stride)
+        {
+            unsigned char valueY = pY[stepY*(i - shiftY)];
+            unsigned char valueU = pU[stepUV*(i/2)];
+            unsigned char valueV = pV[stepUV*(i/2)];
+            if(flags & (SkinPixels | CalibPixels))
+            {
+                yuvToRgb(valueY, valueU, valueV, tempRed, tempGreen, tempBlue);
+                if( ((flags & SkinPixels) && !isSkinColor(tempRed, tempGreen, tempBlue)) || ((flags & CalibPixels) && !isCalibColor(tempGreen)) )
+                {
+                    if(runStart >= 0)
+                    {
+                        QRoiRun run = {j, runStart, i};
+                        m_overlay.runs.append(run);
+                        runStart = -1;
+                    }
+                    continue;
+                }
+            }
+            area++;
+            sumY += valueY;
+            sumU += valueU;
+            sumV += valueV;
+            if(squares)
+            {
+                squaresY += (valueY - 16)*(valueY - 16);
+            }
+            if((flags & MarkPixels) && (stride > 1))
+            {
+                QRoiRun run = {j, i, i + 1}; // samples are not adjacent
+                m_overlay.runs.append(run);
+            }
+            else if((flags & MarkPixels) && (runStart < 0))
+            {
+                runStart = i;
+            }
+        }
+        if(runStart >= 0)
+        {
+            QRoiRun run = {j, runStart, right};
+            m_overlay.runs.append(run);
+        }
+    }
+    if(flags & MarkPixels)
+    {
+        m_overlay.marks = QRoiOverlay::MarkRed; // preview shows luma only, the whole pixel is marked
+    }
+
+    //conversion is linear, so the sums can be converted instead of every pixel (the only difference is saturation of the single pixels)
+    double y = 1.164 * ((double)sumY - 16.0*area);
+    double u = (double)sumU - 128.0*area;
+    double v = (double)sumV - 128.0*area;
+    double max = 255.0*area;
+    red = (unsigned long)qBound(0.0, y + 1.596*v, max);
+    green = (unsigned long)qBound(0.0, y - 0.813*v - 0.391*u, max);
+    blue = (unsigned long)qBound(0.0, y + 2.018*u, max);
+    if(squares && (area > 0))
+    {
+        // green of a pixel is estimated as 1.164*(Y - 16) + c, where c is the mean chroma term, so squares agree with the green sum
+        double c = ((double)green - y) / area;
+        squares[1] += (unsigned long long)qMax(0.0, 1.164*1.164*squaresY + 2.0*1.164*c*((double)sumY - 16.0*area) + c*c*area + 0.5);
+    }
+    return area;
+}
+
+
+//------------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::updateEllipsSpans(const cv::Rect &region)
+{
+    v_ellipsSpans.resize(region.height);
+    double halfWidth = m_ellipsRect.width / 2.0;
+    double halfHeight = m_ellipsRect.height / 2.0;
+    double centerX = m_ellipsRect.x + halfWidth;
+    double centerY = m_ellipsRect.y + halfHeight;
+    for(int j = region.y; j < region.y + region.height; j++)
+    {
+        int left = region.x;
+        int right = region.x;
+        double cy = (centerY - j) / halfHeight;
+        if((halfWidth > 0.0) && (cy*cy < 1.0))
+        {
+            // isInEllips(...) cuts a single span from the row, the closed form estimate of its bounds is corrected by the test itself, so spans match it exactly
+            double halfSpan = halfWidth * std::sqrt(1.0 - cy*cy);
+            left = qBound(region.x, (int)std::floor(centerX - halfSpan), region.x + region.width);
+            right = qBound(left, (int)std::ceil(centerX + halfSpan) + 1, region.x + region.width);
+            while((left < right) && !isInEllips(left, j))
+                left++;
+            while((left > region.x) && isInEllips(left - 1, j))
+                left--;
+            while((right > left) && !isInEllips(right - 1, j))
+                right--;
+            while((right < region.x + region.width) && isInEllips(right, j))
+                right++;
+        }
+        v_ellipsSpans[j - region.y] = cv::Range(left, right);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::resetOverlay()
+{
+    m_overlay.runs.resize(0); // keeps the memory of the previous frame, the receiver has released it already
+    m_overlay.marks = QRoiOverlay::NoMarks;
+    m_overlay.outline = cv::Rect();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::appendOverlayRuns(const cv::Mat &mask, const cv::Rect &region)
+{
+    for(int j = 0; j < region.height; j++)
+    {
+        const unsigned char *p = mask.ptr(j);
+        int i = 0;
+        while(i < region.width)
+        {
+            while((i < region.width) && (p[i] == 0))
+                i++;
+            int start = i;
+            while((i < region.width) && (p[i] != 0))
+                i++;
+            if(i > start)
+            {
+                QRoiRun run = {region.y + j, region.x + start, region.x + i};
+                m_overlay.runs.append(run);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::prepareRoiBuffers(const cv::Mat &input, const cv::Rect &region)
+{
+    int cn = input.channels();
+    int width = input.cols + m_blurSize; // the widest region is the whole frame
+    m_scratch.reserve(m_roiBuffers.columnSums, cn*width);
+    m_scratch.reserve(m_roiBuffers.row, cn*width);
+    m_scratch.reserve(m_roiBuffers.rowMask, width);
+    m_roiBuffers.mask = m_scratch.mat(m_maskMemory, cv::Size(input.cols, input.rows), region.size(), CV_8UC1);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+cv::Rect QOpencvProcessor::skinScanRegion()
+{
+    if((m_skinBox.area() == 0) || (m_framesSinceRescan >= SKIN_RESCAN_PERIOD))
+    {
+        m_framesSinceRescan = 0;
+        return m_cvRect;
+    }
+    m_framesSinceRescan++;
+    // margin lets the box follow the motion, skin at the margin widens the box on the next frame
+    int dX = m_skinBox.width / SKIN_BOX_MARGIN_DIVIDER + m_blurSize;
+    int dY = m_skinBox.height / SKIN_BOX_MARGIN_DIVIDER + m_blurSize;
+    return cv::Rect(m_skinBox.x - dX, m_skinBox.y - dY, m_skinBox.width + 2*dX, m_skinBox.height + 2*dY) & m_cvRect;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::updateSkinBox(unsigned long area)
+{
+    if(area < SKIN_COLLAPSE_RATIO * m_skinArea)
+    {
+        m_skinBox = cv::Rect(); // skin has left the box or the light has changed, so the whole region is scanned again
+    }
+    else
+    {
+        // enrolled pixels are already collected as overlay runs, their bounds are the box
+        int left = m_cvRect.x + m_cvRect.width; // runs lie inside m_cvRect
+        int right = m_cvRect.x;
+        int top = m_cvRect.y + m_cvRect.height;
+        int bottom = m_cvRect.y;
+        for(int k = 0; k < m_overlay.runs.size(); k++)
+        {
+            const QRoiRun &run = m_overlay.runs.at(k);
+            left = qMin(left, run.start);
+            right = qMax(right, run.end);
+            top = qMin(top, run.row);
+            bottom = qMax(bottom, run.row + 1);
+        }
+        m_skinBox = (m_overlay.runs.size() > 0) ? cv::Rect(left, top, right - left, bottom - top) : cv::Rect();
+    }
+    m_skinArea = area;
 }
 
 //------------------------------------------------------------------------------------------------------
 
 void QOpencvProcessor::customProcess(const cv::Mat &input)
 {
-    cv::Mat output(input); // Copy the header and pointer to data of input object
-    cv::Mat temp; // temporary object
+    cv::Size size = frameSize(input);
+    cv::Mat output = m_scratch.mat(m_customMemory, size, size, CV_8UC1); // scratch buffers are reused from frame to frame
 
     //-------------CUSTOM ALGORITHM--------------
 
     //You can do here almost whatever you wnat...
-    cv::cvtColor(output,temp,CV_BGR2GRAY);
-    cv::equalizeHist(temp,temp);
-    cv::Canny(temp,output,10,100);
+    cv::Canny(grayPyramid(input).equalized(0), output, 10, 100); // grayscale levels of the frame are shared, do not change them
 
     //----------END OF CUSTOM ALGORITHM----------
 
@@ -75,8 +499,7 @@ void QOpencvProcessor::customProcess(const cv::Mat &input)
     }
 
     //-------------Time measurement--------------
-    m_framePeriod = (cv::getTickCount() -  m_timeCounter) * 1000.0 / cv::getTickFrequency(); // result is calculated in milliseconds
-    m_timeCounter = cv::getTickCount();
+    updateFramePeriod();
 
     emit frameProcessed(output, m_framePeriod, output.cols*output.rows);
 }
@@ -86,12 +509,18 @@ void QOpencvProcessor::customProcess(const cv::Mat &input)
 void QOpencvProcessor::setRect(const cv::Rect &input_rect)
 {
     m_cvRect = input_rect;
+    m_skinBox = cv::Rect(); // the next frame is scanned fully
 }
 
 //------------------------------------------------------------------------------------------------------
 
 bool QOpencvProcessor::loadClassifier(const std::string &filename)
 {
+    m_cascadeFilename = filename;
+    if(pt_faceDetector)
+    {
+        QMetaObject::invokeMethod(pt_faceDetector, "loadClassifier", Qt::QueuedConnection, Q_ARG(QString, QString::fromStdString(filename)));
+    }
     return m_classifier.load( filename );
 }
 
@@ -99,11 +528,18 @@ bool QOpencvProcessor::loadClassifier(const std::string &filename)
 void QOpencvProcessor::faceProcess(const cv::Mat &input)
 {
     cv::Mat output(input);  // Copy the header and pointer to data of input object
-    cv::Mat gray; // Create an instance of cv::Mat for temporary image storage
-    cv::cvtColor(output, gray, CV_BGR2GRAY);
-    cv::equalizeHist(gray, gray);
-    std::vector<cv::Rect> faces_vector;
-    m_classifier.detectMultiScale(gray, faces_vector, 1.1, 11, cv::CASCADE_DO_ROUGH_SEARCH|cv::CASCADE_FIND_BIGGEST_OBJECT, cv::Size(OBJECT_MINSIZE, OBJECT_MINSIZE)); // Detect faces (list of flags CASCADE_DO_CANNY_PRUNING, CASCADE_DO_ROUGH_SEARCH, CASCADE_FIND_BIGGEST_OBJECT, CASCADE_SCALE_IMAGE )
+    std::vector<cv::Rect> &faces_vector = v_faces; // memory of the vector is reused
+    faces_vector.clear();
+    resetOverlay();
+    if((m_detectionPeriod > 1) || pt_faceDetector)
+    {
+        detectOrTrackFace(input, faces_vector);
+    }
+    else
+    {
+        const cv::Mat &gray = grayPyramid(input).equalized(0);
+        m_classifier.detectMultiScale(gray, faces_vector, 1.1, 11, cv::CASCADE_DO_ROUGH_SEARCH|cv::CASCADE_FIND_BIGGEST_OBJECT, cv::Size(OBJECT_MINSIZE, OBJECT_MINSIZE)); // Detect faces (list of flags CASCADE_DO_CANNY_PRUNING, CASCADE_DO_ROUGH_SEARCH, CASCADE_FIND_BIGGEST_OBJECT, CASCADE_SCALE_IMAGE )
+    }
 
     cv::Rect face(0,0,0,0);
     if(faces_vector.size() == 0) {
@@ -126,81 +562,107 @@ void QOpencvProcessor::faceProcess(const cv::Mat &input)
     unsigned int dX = rectwidth/16;
     unsigned int dY = rectheight/30;
     unsigned long area = 0;
+    unsigned long long squares[3*(FACE_REGIONS + 1)] = {0}; // squares of blue, green and red of every region for the sampling error
+    unsigned long long *pt_squares = (m_sampleStride > 1) ? squares : NULL;
+    QRoiKernels::Sums sums[FACE_REGIONS + 1] = {{0, 0, 0, 0}}; // the whole face goes first, then QFaceRegions
 
     if(face.area() > 0)
     {
-        cv::Mat blurRegion(output, face);
-        cv::blur(blurRegion, blurRegion, cv::Size(m_blurSize, m_blurSize));
         m_ellipsRect = cv::Rect(X + dX, Y - 6 * dY, rectwidth - 2 * dX, rectheight + 6 * dY);
-        unsigned char *p; // this pointer will be used to store adresses of the image rows
-        unsigned char tempBlue;
-        unsigned char tempRed;
-        unsigned char tempGreen;
-        if(output.channels() == 3)
+        cv::Size size = frameSize(input);
+        cv::Rect skinRegion = cv::Rect((int)X, (int)Y - 2*(int)dY, rectwidth, rectheight + 2*dY) & cv::Rect(0, 0, size.width, size.height);
+        if(m_skinFlag)
         {
-            if(m_skinFlag)
+            m_scratch.reserve(v_ellipsSpans, size.height);
+            updateEllipsSpans(skinRegion);
+        }
+        bool skinScan = m_skinFlag && ((m_pixelFormat != QFrameRing::BGRFormat) || (output.channels() == 3)); // grayscale frame is enrolled whole
+        cv::Rect regions[FACE_REGIONS + 1];
+        const cv::Range *spans[FACE_REGIONS + 1];
+        regions[0] = skinScan ? skinRegion : face;
+        spans[0] = (skinScan && (skinRegion.height > 0)) ? &v_ellipsSpans[0] : NULL; // the spans are empty if the region is out of the frame
+        int count = 1;
+        cv::Rect bounding = regions[0];
+        if(m_faceRegionsFlag)
+        {
+            for(int i = 0; i < FACE_REGIONS; i++)
             {
-                for(unsigned int j = Y - 2*dY; j < Y + rectheight; j++) // it is lucky that unsigned int saves from out of image memory cells processing from image top bound, but not from bottom where you should check this issue explicitly
-                {
-                    p = output.ptr(j); //takes pointer to beginning of data on row
-                    for(unsigned int i = X; i < X + rectwidth; i++)
-                    {
-                        tempBlue = p[3*i];
-                        tempGreen = p[3*i+1];
-                        tempRed = p[3*i+2];
-                        if( isSkinColor(tempRed, tempGreen, tempBlue) && isInEllips(i, j)) {
-                            area++;
-                            blue += tempBlue;
-                            green += tempGreen;
-                            red += tempRed;
-                            //p[3*i] = 255;
-                            //p[3*i+1] %= LEVEL_SHIFT;
-                            p[3*i+2] %= LEVEL_SHIFT;
-                        }
-                    }
-                }
-            } else {
-                for(unsigned int j = Y; j < Y + rectheight; j++)
+                regions[count] = QFaceRegions::region(i, face) & cv::Rect(0, 0, size.width, size.height);
+                spans[count] = NULL;
+                if(regions[count].area() > 0)
                 {
-                    p = output.ptr(j); //takes pointer to beginning of data on row
-                    for(unsigned int i = X; i < X + rectwidth; i++)
-                    {
-                        blue += p[3*i];
-                        green += p[3*i+1];
-                        red += p[3*i+2];
-                        //Uncomment if want to see the enrolled domain on image
-                        //p[3*i] = 0;
-                        //p[3*i+1] %= LEVEL_SHIFT;
-                        p[3*i+2] %= LEVEL_SHIFT;
-                    }
+                    bounding = (bounding.area() > 0) ? (bounding | regions[count]) : regions[count]; // the same bounding rect as QRoiKernels::accumulateBlurredRegions(...) uses
                 }
-                area = rectwidth*rectheight;
+                count++;
+            }
+        }
+        if(m_pixelFormat != QFrameRing::BGRFormat)
+        {
+            // conversion of YUV is made per pixel, there are no shared sums, sub-regions are small, so the extra reads are a fraction of the face pass
+            for(int i = 0; i < count; i++)
+            {
+                int flags = skinScan ? (SkinPixels | ((i == 0) ? EllipsPixels : 0)) : AllPixels;
+                flags |= SmoothedPixels | SampledPixels | MarkPixels; // enrolled pixels of the sub-regions are marked too, as the BGR path does
+                sums[i].area = accumulateYUV(input, regions[i], flags, sums[i].red, sums[i].green, sums[i].blue, pt_squares ? pt_squares + 3*i : NULL);
+            }
+        }
+        else
+        {
+            // box filter, classification and summation of the face and its sub-regions are made in one pass, the frame is not changed, enrolled pixels go to the overlay
+            prepareRoiBuffers(output, bounding);
+            int flags = skinScan ? QRoiKernels::SkinPixels : QRoiKernels::AllPixels;
+            if(output.channels() == 3)
+            {
+                flags |= QRoiKernels::MarkRed;
             }
-        } else {
-            for(unsigned int j = Y; j < Y + rectheight; j++)
+            QRoiKernels::accumulateBlurredRegions(output, regions, spans, count, m_blurSize, flags, m_colorClassifier, sums, m_roiBuffers, m_sampleStride, pt_squares);
+            if(output.channels() == 3)
             {
-                p = output.ptr(j);//pointer to beginning of data on rows
-                for(unsigned int i = X; i < X + rectwidth; i++)
+                appendOverlayRuns(m_roiBuffers.mask, bounding);
+                m_overlay.marks = QRoiOverlay::MarkRed;
+            }
+            else
+            {
+                for(int i = 0; i < count; i++)
                 {
-                    green += p[i];
-                    //Uncomment if want to see the enrolled domain on image
-                    //p[i] = 0;
+                    sums[i].blue = sums[i].green;
+                    sums[i].red = sums[i].green;
                 }
             }
-            blue = green;
-            red = green;
-            area = rectwidth*rectheight;
+        }
+        red = sums[0].red;
+        green = sums[0].green;
+        blue = sums[0].blue;
+        area = sums[0].area;
+        if(m_faceRegionsFlag)
+        {
+            m_regionsFrame.cells.resize(FACE_REGIONS); // detaches from the previous frame only if the receiver still holds it
+            QMapCell *cells = m_regionsFrame.cells.data();
+            for(int i = 0; i < FACE_REGIONS; i++)
+            {
+                cells[i].id = i;
+                cells[i].red = sums[i + 1].red;
+                cells[i].green = sums[i + 1].green;
+                cells[i].blue = sums[i + 1].blue;
+                cells[i].area = sums[i + 1].area;
+            }
+            m_regionsFrame.timestamp = m_frameTimestamp;
+            emit regionsCollected(m_regionsFrame);
         }
     }
 
 
     //-----end of if(faces_vector.size() != 0)-----
-    m_framePeriod = ((double)cv::getTickCount() -  m_timeCounter)*1000.0 / cv::getTickFrequency();
-    m_timeCounter = cv::getTickCount();
+    if(m_pixelFormat != QFrameRing::BGRFormat)
+    {
+        output = grayPyramid(input).gray(0); // preview of YUV frame is its luma, YUYV luma is converted once per frame
+    }
+    updateFramePeriod();
     if(area > 0)
     {
         //cv::rectangle( output, face , cv::Scalar(255,25,25));
-        emit dataCollected( red , green, blue, area, m_framePeriod);
+        emit dataCollected( red , green, blue, area, m_frameTimestamp);
+        emit samplingErrorEstimated(samplingError(area, green, squares[1]));
     }
     else
     {
@@ -213,11 +675,161 @@ void QOpencvProcessor::faceProcess(const cv::Mat &input)
             emit selectRegion( QT_TRANSLATE_NOOP("QImageWidget", "Come closer or change light") );
         }
     }
+    emit overlayProcessed(m_overlay);
     emit frameProcessed(output, m_framePeriod, area);
 }
 
 //------------------------------------------------------------------------------------------------
 
+void QOpencvProcessor::detectOrTrackFace(const cv::Mat &input, std::vector<cv::Rect> &faces)
+{
+    m_detectionImage = grayPyramid(input).equalized(DETECTION_LEVEL); // shares the level, it is not changed here
+    cv::Size size = frameSize(input);
+    if(pt_faceDetector)
+    {
+        // cascade works in its own thread, a new result restarts the track from the face patch it was found by
+        pt_faceDetector->submit(m_detectionImage);
+        cv::Rect face;
+        cv::Mat patch = m_scratch.mat(m_templateMemory, m_detectionImage.size(), m_detectionImage.size(), CV_8UC1); // the detector takes the part of the face size
+        if(pt_faceDetector->takeResult(face, patch))
+        {
+            m_trackFlag = (face.area() > 0);
+            m_trackRect = face;
+            if(m_trackFlag)
+            {
+                m_trackTemplate = patch;
+            }
+        }
+        if(m_trackFlag && !trackFace(faces, size))
+        {
+            m_trackFlag = false; // no face till the next detection
+        }
+        return;
+    }
+
+    if(m_trackFlag && (m_framesSinceDetection < m_detectionPeriod))
+    {
+        if(trackFace(faces, size))
+        {
+            m_framesSinceDetection++;
+            return;
+        }
+        // track is lost, so the cascade is run on this frame
+    }
+
+    int minSize = cvRound(OBJECT_MINSIZE * DETECTION_SCALE);
+    m_classifier.detectMultiScale(m_detectionImage, faces, 1.1, 11, cv::CASCADE_DO_ROUGH_SEARCH|cv::CASCADE_FIND_BIGGEST_OBJECT, cv::Size(minSize, minSize));
+    m_framesSinceDetection = 1;
+    m_trackFlag = (faces.size() > 0);
+    if(m_trackFlag)
+    {
+        m_trackRect = faces[0];
+        m_trackTemplate = m_scratch.mat(m_templateMemory, m_detectionImage.size(), m_trackRect.size(), CV_8UC1);
+        m_detectionImage(m_trackRect).copyTo(m_trackTemplate);
+        faces[0] = fromDetectionScale(m_trackRect, size);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool QOpencvProcessor::trackFace(std::vector<cv::Rect> &faces, const cv::Size &size)
+{
+    // the face is searched by the template in the window around its last position
+    cv::Rect window = cv::Rect(m_trackRect.x - m_trackRect.width / TRACK_MARGIN_DIVIDER, m_trackRect.y - m_trackRect.height / TRACK_MARGIN_DIVIDER,
+                               m_trackRect.width + 2 * (m_trackRect.width / TRACK_MARGIN_DIVIDER), m_trackRect.height + 2 * (m_trackRect.height / TRACK_MARGIN_DIVIDER))
+                      & cv::Rect(0, 0, m_detectionImage.cols, m_detectionImage.rows);
+    if((window.width < m_trackTemplate.cols) || (window.height < m_trackTemplate.rows) || m_trackTemplate.empty())
+    {
+        return false;
+    }
+    cv::Mat response = m_scratch.mat(m_responseMemory, m_detectionImage.size(), cv::Size(window.width - m_trackTemplate.cols + 1, window.height - m_trackTemplate.rows + 1), CV_32FC1);
+    cv::matchTemplate(m_detectionImage(window), m_trackTemplate, response, CV_TM_CCOEFF_NORMED);
+    double score;
+    cv::Point position;
+    cv::minMaxLoc(response, NULL, &score, NULL, &position);
+    if(score <= TRACK_MIN_SCORE)
+    {
+        return false;
+    }
+    m_trackRect.x = window.x + position.x;
+    m_trackRect.y = window.y + position.y;
+    faces.push_back(fromDetectionScale(m_trackRect, size));
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+cv::Rect QOpencvProcessor::fromDetectionScale(const cv::Rect &rect, const cv::Size &size) const
+{
+    // pyramid levels are rounded up for odd sizes, so the scaled rect may overhang the frame by a pixel
+    return cv::Rect(cvRound(rect.x / DETECTION_SCALE), cvRound(rect.y / DETECTION_SCALE), cvRound(rect.width / DETECTION_SCALE), cvRound(rect.height / DETECTION_SCALE))
+           & cv::Rect(0, 0, size.width, size.height);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::setAsyncDetection(bool value)
+{
+    if(pt_faceDetector)
+    {
+        pt_detectorThread->quit();
+        pt_detectorThread->wait();
+        delete pt_faceDetector;
+        delete pt_detectorThread;
+        pt_faceDetector = NULL;
+        pt_detectorThread = NULL;
+    }
+    m_trackFlag = false;
+    if(value)
+    {
+        pt_faceDetector = new QFaceDetector(cvRound(OBJECT_MINSIZE * DETECTION_SCALE));
+        pt_faceDetector->loadClassifier(QString::fromStdString(m_cascadeFilename));
+        pt_detectorThread = new QThread();
+        pt_faceDetector->moveToThread(pt_detectorThread);
+        pt_detectorThread->start();
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::setSampleStride(int stride)
+{
+    m_sampleStride = ((stride == 2) || (stride == 4)) ? stride : 1;
+    m_skinBox = cv::Rect(); // enrolled area of the other stride is not comparable, the next frame is scanned fully
+}
+
+//------------------------------------------------------------------------------------------------
+
+qreal QOpencvProcessor::samplingError(unsigned long area, unsigned long sum, unsigned long long squares) const
+{
+    if((m_sampleStride == 1) || (area < 2))
+    {
+        return 0.0;
+    }
+    qreal mean = (qreal)sum / area;
+    qreal variance = qMax(((qreal)squares - area*mean*mean) / (area - 1), 0.0);
+    // standard error of the mean of area samples taken from about area*stride pixels (finite population correction),
+    // pixels are assumed independent, the box filter correlates the neighbours, so the real error is usually smaller
+    return std::sqrt((1.0 - 1.0/m_sampleStride) * variance / area);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::setFaceRegions(bool value)
+{
+    m_faceRegionsFlag = value;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void QOpencvProcessor::setFaceTracking(bool value)
+{
+    m_detectionPeriod = value ? DEFAULT_DETECTION_PERIOD : 1;
+    m_trackFlag = false;
+}
+
+//------------------------------------------------------------------------------------------------
+
 void QOpencvProcessor::rectProcess(const cv::Mat &input)
 {
     cv::Mat output(input); //Copy constructor
@@ -226,7 +838,8 @@ void QOpencvProcessor::rectProcess(const cv::Mat &input)
     unsigned int X = m_cvRect.x;
     unsigned int Y = m_cvRect.y;
 
-    if( (output.rows < (Y + rectheight)) || (output.cols < (X + rectwidth)) )
+    cv::Size size = frameSize(input);
+    if( ((unsigned int)size.height < (Y + rectheight)) || ((unsigned int)size.width < (X + rectwidth)) )
     {
         rectheight = 0;
         rectwidth = 0;
@@ -236,105 +849,72 @@ void QOpencvProcessor::rectProcess(const cv::Mat &input)
     unsigned long green = 0;
     unsigned long blue = 0;
     unsigned long area = 0;
+    unsigned long long squares[3] = {0, 0, 0}; // squares of blue, green and red for the sampling error
+    unsigned long long *pt_squares = (m_sampleStride > 1) ? squares : NULL;
+    resetOverlay();
     //-------------------------------------------------------------------------
     if((rectheight > 0) && (rectwidth > 0))
     {
-        cv::Mat blurRegion(output, m_cvRect);
-        cv::blur(blurRegion, blurRegion, cv::Size(m_blurSize, m_blurSize));
-
-        unsigned char *p; // a pointer to store the adresses of image rows
-        if(output.channels() == 3)
+        bool skinScan = (m_skinFlag || m_seekCalibColors) && ((m_pixelFormat != QFrameRing::BGRFormat) || (output.channels() == 3));
+        cv::Rect region = skinScan ? skinScanRegion() : m_cvRect; // in skin mode only the box around the skin found on the previous frames is scanned
+        if(m_pixelFormat == QFrameRing::BGRFormat)
+        {
+            prepareRoiBuffers(output, region);
+        }
+        if(m_pixelFormat != QFrameRing::BGRFormat)
         {
             if(m_seekCalibColors)
             {
-                unsigned char tempRed;
-                unsigned char tempGreen;
-                unsigned char tempBlue;
-                for(unsigned int j = Y; j < Y + rectheight; j++)
-                {
-                    p = output.ptr(j); //takes pointer to beginning of data on rows
-                    for(unsigned int i = X; i < X + rectwidth; i++)
-                    {
-                        tempBlue = p[3*i];
-                        tempGreen = p[3*i+1];
-                        tempRed = p[3*i+2];
-                        if( isCalibColor(tempGreen) && isSkinColor(tempRed, tempGreen, tempBlue) ) {
-                            area++;
-                            blue += tempBlue;
-                            green += tempGreen;
-                            red += tempRed;
-                            p[3*i] %= LEVEL_SHIFT;
-                            //p[3*i+1] %= LEVEL_SHIFT;
-                            p[3*i+2] %= LEVEL_SHIFT;
-                        }
-                    }
-                }
-            } else {
-            if(m_skinFlag)
+                area = accumulateYUV(input, region, SkinPixels | CalibPixels | MarkPixels | SmoothedPixels | SampledPixels, red, green, blue, pt_squares);
+            }
+            else if(m_skinFlag)
             {
-                unsigned char tempRed;
-                unsigned char tempGreen;
-                unsigned char tempBlue;
-                for(unsigned int j = Y; j < Y + rectheight; j++)
-                {
-                    p = output.ptr(j); //takes pointer to beginning of data on rows
-                    for(unsigned int i = X; i < X + rectwidth; i++)
-                    {
-                        tempBlue = p[3*i];
-                        tempGreen = p[3*i+1];
-                        tempRed = p[3*i+2];
-                        if( isSkinColor(tempRed, tempGreen, tempBlue)) {
-                            area++;
-                            blue += tempBlue;
-                            green += tempGreen;
-                            red += tempRed;
-                            //p[3*i] = 255;
-                            //p[3*i+1] %= LEVEL_SHIFT;
-                            p[3*i+2] %= LEVEL_SHIFT;
-                        }
-                    }
-                }
+                area = accumulateYUV(input, region, SkinPixels | MarkPixels | SmoothedPixels | SampledPixels, red, green, blue, pt_squares);
             }
             else
             {
-                for(unsigned int j = Y; j < Y + rectheight; j++)
-                {
-                    p = output.ptr(j); //takes pointer to beginning of data on rows
-                    for(unsigned int i = X; i < X + rectwidth; i++)
-                    {
-                        blue += p[3*i];
-                        green += p[3*i+1];
-                        red += p[3*i+2];
-                            //p[3*i] = 255;
-                            //p[3*i+1] = 255;
-                            //p[3*i+2] = 0;
-                    }
-                }
-                area = rectwidth*rectheight;
-            }
+                area = accumulateYUV(input, region, AllPixels | SmoothedPixels | SampledPixels, red, green, blue, pt_squares);
             }
         }
-        else
+        else if(output.channels() == 3)
         {
-            for(unsigned int j = Y; j < Y + rectheight; j++)
+            int flags = QRoiKernels::AllPixels;
+            if(m_seekCalibColors)
             {
-                p = output.ptr(j);//pointer to beginning of data on rows
-                for(unsigned int i = X; i < X + rectwidth; i++)
-                {
-                    green += p[i];
-                        //p[i] = 0;
-                }
+                flags = QRoiKernels::SkinPixels | QRoiKernels::CalibPixels | QRoiKernels::MarkRed | QRoiKernels::MarkBlue;
             }
-            area = rectwidth*rectheight;
+            else if(m_skinFlag)
+            {
+                flags = QRoiKernels::SkinPixels | QRoiKernels::MarkRed;
+            }
+            area = QRoiKernels::accumulateBlurred(output, region, NULL, m_blurSize, flags, m_colorClassifier, red, green, blue, m_roiBuffers, m_sampleStride, pt_squares); // box filter is applied on the fly, the frame is not changed
+            if(flags & (QRoiKernels::MarkRed | QRoiKernels::MarkBlue))
+            {
+                appendOverlayRuns(m_roiBuffers.mask, region);
+                m_overlay.marks = ((flags & QRoiKernels::MarkRed) ? QRoiOverlay::MarkRed : 0) | ((flags & QRoiKernels::MarkBlue) ? QRoiOverlay::MarkBlue : 0);
+            }
+        }
+        else
+        {
+            area = QRoiKernels::accumulateBlurred(output, region, NULL, m_blurSize, QRoiKernels::AllPixels, m_colorClassifier, red, green, blue, m_roiBuffers, m_sampleStride, pt_squares);
+        }
+        if(skinScan)
+        {
+            updateSkinBox(area);
         }
     }
     //------end of if((rectheight > 0) && (rectwidth > 0))
-    m_framePeriod = ((double)cv::getTickCount() -  m_timeCounter)*1000.0 / cv::getTickFrequency();
-    m_timeCounter = cv::getTickCount();
+    if(m_pixelFormat != QFrameRing::BGRFormat)
+    {
+        output = grayPyramid(input).gray(0); // preview of YUV frame is its luma, YUYV luma is converted once per frame
+    }
+    updateFramePeriod();
     if( area > 0 )
     {
-        cv::rectangle( output , m_cvRect, cv::Scalar(255,25,25));
-        emit dataCollected(red, green, blue, area, m_framePeriod);      
+        m_overlay.outline = m_cvRect;
+        m_overlay.outlineColor = cv::Scalar(255,25,25);
+        emit dataCollected(red, green, blue, area, m_frameTimestamp);
+        emit samplingErrorEstimated(samplingError(area, green, squares[1]));
         if(m_calibFlag)
         {
             v_calibValues[m_calibSamples] = (qreal)green/area;
@@ -349,6 +929,7 @@ void QOpencvProcessor::rectProcess(const cv::Mat &input)
                     m_calibError += (v_calibValues[i] - m_calibMean)*(v_calibValues[i] - m_calibMean);
                 }
                 m_calibError = 10 * sqrt( m_calibError /(CALIBRATION_VECTOR_LENGTH - 1) );
+                m_colorClassifier.setCalibration(m_calibMean, m_calibError);
                 qWarning("mean: %f; error: %f; samples: %d", m_calibMean,m_calibError, m_calibSamples);
                 m_calibSamples = 0;
                 m_calibFlag = false;
@@ -361,6 +942,7 @@ void QOpencvProcessor::rectProcess(const cv::Mat &input)
     {
         emit selectRegion( QT_TRANSLATE_NOOP("QImageWidget", "Select region on image" ) );
     }
+    emit overlayProcessed(m_overlay);
     emit frameProcessed(output, m_framePeriod, area);
 }
 
@@ -368,92 +950,97 @@ void QOpencvProcessor::rectProcess(const cv::Mat &input)
 
 void QOpencvProcessor::mapProcess(const cv::Mat &input)
 {
-    cv::Mat output(input);
     int X = m_mapRect.x;
     int Y = m_mapRect.y;
     int W = m_mapRect.width;
     int H = m_mapRect.height;
 
-    if((output.cols >= (X+W)) && (output.rows >= (Y+H)))
+    cv::Size size = frameSize(input);
+    int stepsY = H / m_mapCellSizeY;
+    int stepsX = W / m_mapCellSizeX;
+    if((size.width >= (X+W)) && (size.height >= (Y+H)) && (stepsX > 0) && (stepsY > 0))
     {
-        int stepsY = H / m_mapCellSizeY;
-        int stepsX = W / m_mapCellSizeX;
         int area = m_mapCellSizeY*m_mapCellSizeX;
 
-        unsigned long sumRed = 0;
-        unsigned long sumBlue = 0;
-        unsigned long sumGreen = 0;
+        v_mapSums.resize(3*stepsX*stepsY); // memory is reallocated only when the map grows
+        cv::parallel_for_(cv::Range(0, stepsY), MapBandsBody(this, input, stepsX)); // bands of cells are independent, each one writes its own part of v_mapSums
 
-        int performance_pill;
+        m_mapFrame.cells.resize(stepsX*stepsY); // detaches from the previous frame only if the receiver still holds it
+        QMapCell *cells = m_mapFrame.cells.data();
+        for(int k = 0; k < stepsX*stepsY; k++)
+        {
+            cells[k].id = k;
+            cells[k].red = v_mapSums[3*k+2];
+            cells[k].green = v_mapSums[3*k+1];
+            cells[k].blue = v_mapSums[3*k];
+            cells[k].area = area;
+        }
+        m_mapFrame.timestamp = m_frameTimestamp;
+        emit mapProcessed(m_mapFrame);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------
 
-        if(input.channels() == 3)
+void QOpencvProcessor::accumulateMapBands(const cv::Mat &input, const cv::Range &bands, int stepsX)
+{
+    int X = m_mapRect.x;
+    int Y = m_mapRect.y;
+    for(int i = bands.start; i < bands.end; i++)
+    {
+        unsigned long *sums = &v_mapSums[3*stepsX*i]; // blue, green and red sums of each cell of the band
+        if(m_pixelFormat != QFrameRing::BGRFormat)
         {
-            for(int i = 0; i < stepsY; i++)
+            // bands run in parallel, so only flags that keep accumulateYUV(...) free of member writes are allowed here,
+            // every pixel of the cell is taken, as the BGR path does, cell area is the full cell size
+            const int flags = AllPixels;
+            Q_ASSERT((flags & (MarkPixels | SmoothedPixels)) == 0);
+            for(int j = 0; j < stepsX; j++)
             {
-                for(int p = 0; p < m_mapCellSizeY; p++)
-                {
-                    v_pixelSet[p] = output.ptr(Y + i*m_mapCellSizeY + p);
-                }
-                for(int j = 0; j < stepsX; j++)
-                {
-                    for(int k = 0; k < m_mapCellSizeX; k++)
-                    {
-                        performance_pill = 3*(X + j*m_mapCellSizeX + k);
-                        for(int p = 0; p < m_mapCellSizeY; p++)
-                        {
-                            sumBlue += v_pixelSet[p][performance_pill];
-                            sumGreen += v_pixelSet[p][performance_pill + 1];
-                            sumRed += v_pixelSet[p][performance_pill + 2];
-                        }
-                    }
-                    emit mapCellProcessed(sumRed, sumGreen, sumBlue, area, m_framePeriod);
-                    sumBlue = 0;
-                    sumGreen = 0;
-                    sumRed = 0;
-                }
+                accumulateYUV(input, cv::Rect(X + j*m_mapCellSizeX, Y + i*m_mapCellSizeY, m_mapCellSizeX, m_mapCellSizeY), flags, sums[3*j+2], sums[3*j+1], sums[3*j]);
             }
+            continue;
         }
-        else
+        // cells of the band are summed in one row-major pass, so every row is read once and sequentially
+        std::fill(sums, sums + 3*stepsX, 0);
+        for(int p = 0; p < m_mapCellSizeY; p++)
         {
-            for(int i = 0; i < stepsY; i++)
+            const unsigned char *row = input.ptr(Y + i*m_mapCellSizeY + p);
+            for(int j = 0; j < stepsX; j++)
             {
-                for(int p = 0; p < m_mapCellSizeY; p++)
+                if(input.channels() == 3)
                 {
-                    v_pixelSet[p] = output.ptr(Y + i*m_mapCellSizeY + p);
+                    QRoiKernels::accumulateBGR((unsigned char *)row + 3*(X + j*m_mapCellSizeX), m_mapCellSizeX, QRoiKernels::AllPixels, m_colorClassifier, sums[3*j+2], sums[3*j+1], sums[3*j]); // AllPixels without marks does not write to the row
                 }
-                for(int j = 0; j < stepsX; j++)
+                else
                 {
-                    for(int k = 0; k < m_mapCellSizeX; k++)
-                    {
-                        performance_pill = X + j*m_mapCellSizeX + k;
-                        for(int p = 0; p < m_mapCellSizeY; p++)
-                        {
-                            sumBlue += v_pixelSet[p][performance_pill];
-                        }
-                    }
-                    emit mapCellProcessed(sumBlue, sumBlue, sumBlue, area, m_framePeriod);
-                    sumBlue = 0;
+                    sums[3*j] += QRoiKernels::accumulateGray(row + X + j*m_mapCellSizeX, m_mapCellSizeX);
                 }
             }
         }
+        if(input.channels() != 3)
+        {
+            for(int j = 0; j < stepsX; j++)
+            {
+                sums[3*j+1] = sums[3*j];
+                sums[3*j+2] = sums[3*j];
+            }
+        }
     }
 }
 
+//-----------------------------------------------------------------------------------------------
+
 void QOpencvProcessor::setMapCellSize(quint16 sizeX, quint16 sizeY)
 {
     m_mapCellSizeX = sizeX;
     m_mapCellSizeY = sizeY;
-    if(v_pixelSet)
-    {
-        delete[] v_pixelSet;
-        v_pixelSet = NULL;
-    }
-    v_pixelSet = new unsigned char*[m_mapCellSizeY];
 }
 
 void QOpencvProcessor::setSkinSearchingFlag(bool value)
 {
     m_skinFlag = value;
+    m_skinBox = cv::Rect();
 }
 
 void QOpencvProcessor::calibrate(bool value)
@@ -468,6 +1055,11 @@ void QOpencvProcessor::calibrate(bool value)
     }
 }
 
+void QOpencvProcessor::setSkinRule(int rule)
+{
+    m_colorClassifier.setSkinRule((QColorClassifier::SkinRule)rule);
+}
+
 void QOpencvProcessor::setBlurSize(int size)
 {
     if(size > 1)
@@ -9,11 +9,23 @@ The simplest way to use it - rewrite appropriate section in QOpencvProcessor::cu
 //------------------------------------------------------------------------------------------------------
 
 #include <QObject>
+#include <QThread>
 #include <opencv2/opencv.hpp>
 
+#include "qframering.h"
+#include "qcolorclassifier.h"
+#include "qroikernels.h"
+#include "qmapframe.h"
+#include "qroioverlay.h"
+#include "qfaceregions.h"
+#include "qscratcharena.h"
+#include "qgraypyramid.h"
+#include "qfacedetector.h"
+
 #define CALIBRATION_VECTOR_LENGTH 25
 #define FACE_RECT_VECTOR_LENGTH 9
 #define FRAMES_WITHOUT_FACE_TRESHOLD 9
+#define DEFAULT_DETECTION_PERIOD 10 // frames between cascade runs in face tracking mode
 
 //------------------------------------------------------------------------------------------------------
 
@@ -22,18 +34,25 @@ class QOpencvProcessor : public QObject
     Q_OBJECT
 public:
     explicit QOpencvProcessor(QObject *parent = 0);
+    ~QOpencvProcessor();
 
 signals:
     void frameProcessed(const cv::Mat& value, double frame_period, quint32 pixels_enrolled); //should be emited in the end of each frame processing
-    void dataCollected(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double period);
+    void dataCollected(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double timestamp); // timestamp is the capture time of the frame in ms
     void selectRegion(const char * string);     // emit it if no objects has been detected or no regions are selected
-    void mapCellProcessed(unsigned long red, unsigned long green, unsigned long blue, unsigned long area, double period);
+    void overlayProcessed(const QRoiOverlay &overlay);  // highlight of the frame, is emitted just before frameProcessed(...), to use it by Qt::QueuedConnection do qRegisterMetaType<QRoiOverlay>("QRoiOverlay")
+    void mapProcessed(const QMapFrame &frame);   // sums of all map cells of the frame, to use it by Qt::QueuedConnection do qRegisterMetaType<QMapFrame>("QMapFrame")
+    void regionsCollected(const QMapFrame &frame); // sums of the face sub-regions, cell id is QFaceRegions::Region, see setFaceRegions(...)
     void mapRegionUpdated(const cv::Rect& rect);
     void calibrationDone(qreal mean, qreal stdev, quint16 samples);
+    void frameDequeued(const cv::Mat& value);  // is emitted for each frame taken from QFrameRing, connect processing slots to it by Qt::DirectConnection
+    void stagesTimed(qreal capture_time, qreal processing_time); // time spent on frame capture and on frame processing, in ms
+    void queueStatus(quint32 dropped, quint32 coalesced); // frames lost between capture and processing, see QFrameRing::Policy
+    void slotsReleased();   // processQueuedFrames() has returned slots to QFrameRing, connect it to QVideoCapture::continueWriting()
+    void samplingErrorEstimated(qreal error); // standard error of green mean of the region caused by the sample stride, 0 if every pixel is taken
 
 public slots:
     void customProcess(const cv::Mat &input);   // just a template of how a program logic should work
-    void updateTime();                          // use it in the beginning of any time-measurement operations
     void setRect(const cv::Rect &input_rect);   // sets m_cvrect
     void faceProcess(const cv::Mat &input);     // an algorithm that evaluates PPG from skin region, region evaluates by means of opencv's cascadeclassifier functions
     void rectProcess(const cv::Mat &input);     // an algorithm that evaluates PPG from skin region defined by user
@@ -41,24 +60,42 @@ public slots:
     void mapProcess(const cv::Mat &input);
     void calibrate(bool value);
     void setBlurSize(int size);
+    void setSkinRule(int rule);                 // see QColorClassifier::SkinRule
+    void setFaceTracking(bool value);           // if true, faceProcess(...) runs the cascade on downscaled image every DEFAULT_DETECTION_PERIOD frames or on track loss and tracks the face by template in between
+    void setAsyncDetection(bool value);         // if true, faceProcess(...) takes the face from QFaceDetector that runs in its own thread and tracks it between detections
+    void setFaceRegions(bool value);            // if true, faceProcess(...) also accumulates QFaceRegions in the same pass and emits regionsCollected(...)
+    void setSampleStride(int stride);           // 1 - every pixel of the region is taken, 2 - checkerboard, 4 - every 4th pixel, see QRoiKernels::accumulateBlurred(...)
 
     cv::Rect getRect(); // returns current m_cvRect
+    quint32 scratchResizes() const; // resizes of the scratch arena buffers, it does not grow while frame size and mode are the same
     void setMapRegion(const cv::Rect &input_rect); // sets up map region, see m_mapRect
     void setMapCellSize(quint16 sizeX, quint16 sizeY);
     void setSkinSearchingFlag(bool value);
+    void setFrameRing(QFrameRing *ring);    // sets the ring that should be drained by processQueuedFrames()
+    void processQueuedFrames();             // takes all available frames from QFrameRing and emits frameDequeued(...) for each of them
 
 private:
     bool m_fullFaceFlag;
     bool m_skinFlag;
-    int64 m_timeCounter;    // stores time of application/computer start
-    double m_framePeriod;   // stores time of frame processing
+    double m_framePeriod;   // stores time between the current and the previous frames, in ms
+    int64 m_timeCounter;    // tick count of the previous frame, used for frames without capture timestamp
+    double m_frameTimestamp;    // capture timestamp of the current frame, in ms
+    double m_lastTimestamp;     // capture timestamp of the previous frame, in ms, negative if the previous frame had none
+    bool m_timestampFlag;       // true while frame from QFrameRing (which carries capture timestamp) is processed
+    QFrameRing::PixelFormat m_pixelFormat; // layout of the current frame, frames that do not come from QFrameRing are BGR
     cv::Rect m_cvRect;      // this rect is used by process_rectregion_pulse slot
     cv::CascadeClassifier m_classifier; //object that manages opencv's image recognition functions
+    QFrameRing *pt_ring;    // a ring with captured frames, NULL by default
 
     quint16 m_mapCellSizeX;
     quint16 m_mapCellSizeY;
     cv::Rect m_mapRect;
-    unsigned char **v_pixelSet; // memory should be allocated in setMapCellSize() call
+    QMapFrame m_mapFrame;   // the last frame of the map, it is reused while the receiver does not hold it
+    QMapFrame m_regionsFrame;   // the same for the face sub-regions
+    bool m_faceRegionsFlag;
+    std::vector<unsigned long> v_mapSums; // blue, green and red sums of the map cells in row-major order, see mapProcess(...)
+    void accumulateMapBands(const cv::Mat &input, const cv::Range &bands, int stepsX); // fills v_mapSums for bands of cells, can be called from several threads for different bands
+    friend class MapBandsBody;
 
     bool m_calibFlag;
     bool m_seekCalibColors;
@@ -66,11 +103,44 @@ private:
     qreal m_calibMean;
     qreal m_calibError;
     quint8 v_calibValues[CALIBRATION_VECTOR_LENGTH];
+    QColorClassifier m_colorClassifier; // skin and calibration colour tables
 
     bool isSkinColor(unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue);
     bool isCalibColor(unsigned char value);
+    void yuvToRgb(int valueY, int valueU, int valueV, unsigned char &valueRed, unsigned char &valueGreen, unsigned char &valueBlue) const;
+
+    enum AccumulationFlags { AllPixels = 0, SkinPixels = 1, CalibPixels = 2, EllipsPixels = 4, MarkPixels = 8, SmoothedPixels = 16, SampledPixels = 32 }; // SmoothedPixels - luma is box filtered by m_blurSize as BGR frames are, SampledPixels - only m_sampleStride pattern is taken
+    // sums YUV frame region and converts the sums to RGB, returns number of enrolled pixels, squares[1] gets squares of green estimated by luma,
+    // without MarkPixels and SmoothedPixels it writes no member (overlay, scratch buffers, arena counter), only such calls can run in parallel, see accumulateMapBands(...)
+    unsigned long accumulateYUV(const cv::Mat &input, const cv::Rect &rect, int flags, unsigned long &red, unsigned long &green, unsigned long &blue, unsigned long long *squares = NULL);
+    cv::Size frameSize(const cv::Mat &input) const; // size of the current frame in pixels, does not match cv::Mat size for I420
+    cv::Mat lumaPlane(const cv::Mat &input);  // Y plane of the current YUV frame (shares data for I420, scratch copy for YUYV), input itself for BGR
 
     int m_blurSize;
+    int m_sampleStride;     // see setSampleStride(...)
+    qreal samplingError(unsigned long area, unsigned long sum, unsigned long long squares) const; // see samplingErrorEstimated(...)
+    QScratchArena m_scratch;    // counts resizes of the scratch buffers below, they are sized by the frame
+    cv::Mat m_grayMemory;       // grayscale copy of BGR frame, level 0 of m_grayPyramid
+    QGrayPyramid m_grayPyramid; // grayscale levels of the current frame, shared by all stages
+    QGrayPyramid &grayPyramid(const cv::Mat &input); // resets m_grayPyramid by the frame on the first call for the frame
+    cv::Mat m_lumaMemory;       // luma of YUYV frame
+    cv::Mat m_blurredLumaMemory;
+    cv::Mat m_maskMemory;       // memory of m_roiBuffers.mask
+    cv::Mat m_templateMemory;   // memory of m_trackTemplate
+    cv::Mat m_responseMemory;   // template matching scores of trackFace(...)
+    cv::Mat m_customMemory;     // output of customProcess(...)
+    std::vector<cv::Rect> v_faces;  // faces found on the current frame
+    QRoiKernels::Buffers m_roiBuffers; // column sums of the box filter and mask of enrolled pixels, see QRoiKernels::accumulateBlurred(...)
+    void prepareRoiBuffers(const cv::Mat &input, const cv::Rect &region); // sizes m_roiBuffers by the frame, so the kernel does not allocate
+    cv::Mat m_blurredLuma;  // smoothed luma of the YUV region, see accumulateYUV(...)
+    cv::Rect m_skinBox;     // bounds of the skin found by rectProcess(...) on the previous frame, empty if the next frame should be scanned fully
+    int m_framesSinceRescan;
+    unsigned long m_skinArea;   // enrolled area of the previous frame
+    cv::Rect skinScanRegion();  // part of m_cvRect that rectProcess(...) scans in skin mode
+    void updateSkinBox(unsigned long area); // takes m_skinBox from the overlay runs of the frame
+    QRoiOverlay m_overlay;  // highlight of the current frame, it is reused while the receiver does not hold it
+    void resetOverlay();
+    void appendOverlayRuns(const cv::Mat &mask, const cv::Rect &region); // adds runs of non zero mask pixels, mask covers the region
 
     quint16 m_emptyFrames;
     cv::Rect v_faceRect[FACE_RECT_VECTOR_LENGTH];
@@ -79,43 +149,42 @@ private:
     cv::Rect getAverageFaceRect() const;
     cv::Rect enrollFaceRect(const cv::Rect &rect);
     bool isInEllips(int x, int y) const;
+    int m_detectionPeriod;          // frames between cascade runs, 1 means that cascade runs on every frame
+    int m_framesSinceDetection;
+    bool m_trackFlag;               // true while the face is tracked
+    cv::Rect m_trackRect;           // tracked face on the downscaled image
+    cv::Mat m_trackTemplate;        // face from the downscaled image of the last detection
+    cv::Mat m_detectionImage;       // equalized DETECTION_LEVEL of m_grayPyramid, read-only
+    QFaceDetector *pt_faceDetector; // asynchronous detector, NULL if cascade runs in this thread
+    QThread *pt_detectorThread;
+    std::string m_cascadeFilename;
+    void detectOrTrackFace(const cv::Mat &input, std::vector<cv::Rect> &faces); // face tracking and asynchronous detection modes of faceProcess(...)
+    bool trackFace(std::vector<cv::Rect> &faces, const cv::Size &size);   // follows m_trackRect by m_trackTemplate, returns false if the track is lost
+    cv::Rect fromDetectionScale(const cv::Rect &rect, const cv::Size &size) const; // rect of the detection level in the frame of size, clipped by the frame
+    std::vector<cv::Range> v_ellipsSpans; // [start, end) of the ellipse on each row of the face region, see updateEllipsSpans(...)
+    void updateEllipsSpans(const cv::Rect &region); // prepares v_ellipsSpans for the region clipped by the frame
+    void updateFramePeriod(); // evaluates m_framePeriod from capture timestamps, processing time is used only for frames without timestamp
 };
 
 inline bool QOpencvProcessor::isSkinColor(unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue)
 {
-    //from Ghazali Osman Muhammad, Suzuri Hitam and Mohd Nasir Ismail
-    //"ENHANCED SKIN COLOUR CLASSIFIER USING RGB RATIO MODEL" International Journal on Soft Computing (IJSC) Vol.3, No.4, November 2012
-    //Swift’s rule
-    /*if( (valueBlue > valueRed)    &&
-        (valueGreen < valueBlue)    &&
-        (valueGreen > valueRed)     &&
-        ( (valueBlue < (valueRed >> 2))  || (valueBlue > 200) ) ) {
-        return false;
-    } else return true;*/
-
-    //Kovac's rule
-    /*if( (valueRed > 95) && (valueRed > valueGreen)    &&
-        (valueGreen > 40) && (valueBlue > 20)           &&
-        ((valueRed - qMin(valueGreen,valueBlue)) > 15)  &&
-        ((valueRed - valueGreen) > 15 ) ) {
-        return true;
-    } else return false;*/
-
-    //Modified Kovac's rule
-    if( (valueRed > 115) &&
-        (valueRed > valueGreen) && (valueBlue > 45)     &&
-        ((valueRed - qMin(valueGreen,valueBlue)) > 35)  &&
-        ((valueRed - valueGreen) > 25 ) ) {
-        return true;
-    } else return false;
+    return m_colorClassifier.isSkin(valueRed, valueGreen, valueBlue); // rules are described in QColorClassifier::skinRuleValue(...)
 }
 
 inline bool QOpencvProcessor::isCalibColor(unsigned char value)
 {
-    if( ((qreal)value < (m_calibMean + m_calibError)) && ((qreal)value > (m_calibMean - m_calibError)))
-    {
-        return true;
-    } else return false;
+    return m_colorClassifier.isCalib(value);
+}
+
+inline void QOpencvProcessor::yuvToRgb(int valueY, int valueU, int valueV, unsigned char &valueRed, unsigned char &valueGreen, unsigned char &valueBlue) const
+{
+    //ITU-R BT.601 with video range, the same as OpenCV uses in cvtColor(...) for YUV inputs, fixed point with 10 bit fraction
+    int c = 1192 * (valueY - 16);
+    int d = valueU - 128;
+    int e = valueV - 128;
+    valueRed = cv::saturate_cast<unsigned char>( (c + 1634*e + 512) >> 10 );
+    valueGreen = cv::saturate_cast<unsigned char>( (c - 832*e - 400*d + 512) >> 10 );
+    valueBlue = cv::saturate_cast<unsigned char>( (c + 2066*d + 512) >> 10 );
 }
 
 inline bool QOpencvProcessor::isInEllips(int x, int y) const
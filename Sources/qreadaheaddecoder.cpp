@@ -0,0 +1,212 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QReadAheadDecoder decodes a video file in its own thread and keeps up to depth decoded frames in the
+QFrameRing ahead of consumption, so a slow keyframe does not stall QVideoCapture timer. Consumer takes
+frames by take(...), frame buffers are swapped between consumer and decoder, so nothing is copied.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qreadaheaddecoder.h"
+#include <QMutexLocker>
+
+//------------------------------------------------------------------------------------------------------
+
+QReadAheadDecoder::QReadAheadDecoder():
+    pt_ring(NULL),
+    m_position(0),
+    m_frameCount(0),
+    m_fps(0.0),
+    m_stopFlag(0),
+    m_endFlag(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QReadAheadDecoder::~QReadAheadDecoder()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QReadAheadDecoder::open(const QString &filename, quint16 depth)
+{
+    close();
+    if(!m_cvCapture.open(filename.toLocal8Bit().constData()))
+    {
+        return false;
+    }
+    pt_ring = new QFrameRing(depth);
+    m_position = 0;
+    m_frameCount = (int)m_cvCapture.get(CV_CAP_PROP_FRAME_COUNT);
+    m_fps = m_cvCapture.get(CV_CAP_PROP_FPS);
+    m_endFlag.store(0);
+    start();
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QReadAheadDecoder::close()
+{
+    stop();
+    m_cvCapture.release();
+    delete pt_ring;
+    pt_ring = NULL;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QReadAheadDecoder::isOpened() const
+{
+    return pt_ring != NULL;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QReadAheadDecoder::stop()
+{
+    if(isRunning())
+    {
+        m_stopFlag.store(1);
+        {
+            QMutexLocker locker(&m_mutex);
+            m_takenCondition.wakeAll();
+        }
+        wait();
+        m_stopFlag.store(0);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QReadAheadDecoder::seek(int number)
+{
+    if(pt_ring == NULL)
+    {
+        return false;
+    }
+    stop();
+    quint16 depth = pt_ring->length();
+    delete pt_ring; // decoded frames are not needed anymore
+    pt_ring = new QFrameRing(depth);
+    bool result = m_cvCapture.set(CV_CAP_PROP_POS_FRAMES, number);
+    m_position = (int)m_cvCapture.get(CV_CAP_PROP_POS_FRAMES);
+    m_endFlag.store(0);
+    start();
+    return result;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QReadAheadDecoder::take(cv::Mat &frame, double &sourceTime, double &decodeTime)
+{
+    if(pt_ring == NULL)
+    {
+        return false;
+    }
+    QFrameRing::Slot *slot = pt_ring->readSlot();
+    if(slot == NULL)
+    {
+        return false;
+    }
+    cv::swap(frame, slot->frame); // consumer gets decoded frame, decoder gets consumer's previous buffer to decode into
+    if(slot->frame.refcount == NULL)
+    {
+        slot->frame.release(); // buffer points into a file mapping, decoder should not write there
+    }
+    sourceTime = slot->timestamp;
+    decodeTime = slot->captureTime;
+    pt_ring->release();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_takenCondition.wakeAll(); // decoder may wait for this slot
+    }
+    m_position++;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QReadAheadDecoder::waitForFrame(unsigned long time)
+{
+    if(pt_ring == NULL)
+    {
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    if((count() == 0) && (m_endFlag.load() == 0) && isRunning())
+    {
+        m_decodedCondition.wait(&m_mutex, time);
+    }
+    return count() > 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+quint16 QReadAheadDecoder::count() const
+{
+    return (pt_ring != NULL) ? pt_ring->count() : 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QReadAheadDecoder::atEnd() const
+{
+    return (m_endFlag.load() != 0) && (count() == 0);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QReadAheadDecoder::position() const
+{
+    return m_position;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QReadAheadDecoder::frameCount() const
+{
+    return m_frameCount;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+double QReadAheadDecoder::fps() const
+{
+    return m_fps;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QReadAheadDecoder::run()
+{
+    while(m_stopFlag.load() == 0)
+    {
+        QFrameRing::Slot *slot = pt_ring->writeSlot();
+        if(slot == NULL)
+        {
+            // queue is full, the flag and the queue are checked again under the mutex, so a wake made after the first check is not lost
+            QMutexLocker locker(&m_mutex);
+            if((m_stopFlag.load() == 0) && (pt_ring->count() == pt_ring->length()))
+            {
+                m_takenCondition.wait(&m_mutex);
+            }
+            continue;
+        }
+        int64 startTime = cv::getTickCount();
+        if( !m_cvCapture.grab() || !m_cvCapture.retrieve(slot->frame) || slot->frame.empty() )
+        {
+            QMutexLocker locker(&m_mutex);
+            m_endFlag.store(1);
+            m_decodedCondition.wakeAll();
+            break;
+        }
+        slot->format = QFrameRing::BGRFormat;
+        slot->timestamp = m_cvCapture.get(CV_CAP_PROP_POS_MSEC); // container timestamp, QVideoCapture makes it monotonic
+        slot->captureTime = (cv::getTickCount() - startTime) * 1000.0 / cv::getTickFrequency();
+        pt_ring->commit();
+        QMutexLocker locker(&m_mutex);
+        m_decodedCondition.wakeAll();
+    }
+}
@@ -0,0 +1,62 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QReadAheadDecoder decodes a video file in its own thread and keeps up to depth decoded frames in the
+QFrameRing ahead of consumption, so a slow keyframe does not stall QVideoCapture timer. Consumer takes
+frames by take(...), frame buffers are swapped between consumer and decoder, so nothing is copied.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QREADAHEADDECODER_H
+#define QREADAHEADDECODER_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QThread>
+#include <QString>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <opencv2/opencv.hpp>
+
+#include "qframering.h"
+
+#define DEFAULT_READ_AHEAD_DEPTH 8
+
+//------------------------------------------------------------------------------------------------------
+
+class QReadAheadDecoder : public QThread
+{
+public:
+    QReadAheadDecoder();
+    ~QReadAheadDecoder();
+
+    bool open(const QString &filename, quint16 depth = DEFAULT_READ_AHEAD_DEPTH); // opens the file and starts decoding
+    void close();
+    bool isOpened() const;
+    bool seek(int number);      // drops decoded frames and restarts decoding from the frame number
+    bool take(cv::Mat &frame, double &sourceTime, double &decodeTime); // consumer side, returns false if no decoded frame is ready
+    bool waitForFrame(unsigned long time); // consumer side, blocks up to time ms till a decoded frame is ready, returns false if there is none
+    quint16 count() const;      // number of decoded frames that are ready
+    bool atEnd() const;         // true when the file is over and all decoded frames are taken
+    int position() const;       // number of the next frame to take
+    int frameCount() const;
+    double fps() const;
+
+protected:
+    void run();
+
+private:
+    cv::VideoCapture m_cvCapture;   // used only by the decoder thread while it runs
+    QFrameRing *pt_ring;
+    int m_position;
+    int m_frameCount;       // properties are read on open(), because m_cvCapture belongs to the decoder thread then
+    double m_fps;
+    QAtomicInt m_stopFlag;
+    QAtomicInt m_endFlag;
+    QMutex m_mutex;                 // guards only the waits below, frames go through the lock-free ring
+    QWaitCondition m_takenCondition; // decoder waits on it while the queue is full, take(...) and stop() wake it
+    QWaitCondition m_decodedCondition; // waitForFrame(...) waits on it, decoder wakes it for each frame and at the end of the file
+
+    void stop();
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QREADAHEADDECODER_H
@@ -0,0 +1,643 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QRoiKernels holds the inner loops of ROI accumulation for BGR and grayscale frames. SIMD versions work on
+interleaved BGR data without deinterleaving: the same row is loaded at offsets 0, 1 and 2 bytes, so the
+bytes 0, 3, 6, 9, 12 (and 15 ... 27 for AVX2) of these loads are blue, green and red of consecutive
+pixels. The skin rule is evaluated for all bytes by saturated subtractions (a > b if a -sat b != 0),
+then only pixel bytes are kept and summed by psadbw into 64-bit accumulators.
+accumulateBlurred(...) keeps sums of the last size rows for every column of the region, a box filtered
+row is built from them into a small buffer that stays in cache and is passed to the row kernels, so
+the frame is read once and is not changed at all, enrolled pixels are returned as a mask.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qroikernels.h"
+#include "qcolorclassifier.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    #define ROI_X86
+    #include <emmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #if (_MSC_VER >= 1800)
+            #include <immintrin.h>
+            #define ROI_AVX2
+        #endif
+        #define ROI_TARGET_SSE2
+        #define ROI_TARGET_AVX2
+    #elif defined(__GNUC__)
+        #include <cpuid.h>
+        #if defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))
+            #include <immintrin.h>
+            #define ROI_AVX2
+        #endif
+        #define ROI_TARGET_SSE2 __attribute__((target("sse2")))
+        #define ROI_TARGET_AVX2 __attribute__((target("avx2")))
+    #else
+        #undef ROI_X86
+    #endif
+#endif
+
+//------------------------------------------------------------------------------------------------------
+
+static unsigned long accumulateBGRScalar(unsigned char *row, int length, int flags, const QColorClassifier &classifier, unsigned long &red, unsigned long &green, unsigned long &blue, unsigned char *mask)
+{
+    unsigned long area = 0;
+    unsigned char tempBlue;
+    unsigned char tempGreen;
+    unsigned char tempRed;
+    for(int i = 0; i < length; i++)
+    {
+        tempBlue = row[3*i];
+        tempGreen = row[3*i+1];
+        tempRed = row[3*i+2];
+        if( ((flags & QRoiKernels::CalibPixels) && !classifier.isCalib(tempGreen)) ||
+            ((flags & QRoiKernels::SkinPixels) && !classifier.isSkin(tempRed, tempGreen, tempBlue)) )
+        {
+            if(mask)
+            {
+                mask[i] = 0;
+            }
+            continue;
+        }
+        if(mask)
+        {
+            mask[i] = 255;
+        }
+        area++;
+        blue += tempBlue;
+        green += tempGreen;
+        red += tempRed;
+        if(flags & QRoiKernels::MarkBlue)
+        {
+            row[3*i] &= ROI_MARK_MASK;
+        }
+        if(flags & QRoiKernels::MarkRed)
+        {
+            row[3*i+2] &= ROI_MARK_MASK;
+        }
+    }
+    return area;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+static unsigned long accumulateGrayScalar(const unsigned char *row, int length)
+{
+    unsigned long sum = 0;
+    for(int i = 0; i < length; i++)
+    {
+        sum += row[i];
+    }
+    return sum;
+}
+
+#ifdef ROI_X86
+//------------------------------------------------------------------------------------------------------
+
+ROI_TARGET_SSE2 static inline unsigned long long sumEpi64(__m128i value)
+{
+    unsigned long long temp[2];
+    _mm_storeu_si128((__m128i*)temp, value);
+    return temp[0] + temp[1];
+}
+
+//------------------------------------------------------------------------------------------------------
+
+ROI_TARGET_SSE2 static unsigned long accumulateBGRSSE2(unsigned char *row, int length, int flags, const QColorClassifier &classifier, unsigned long &red, unsigned long &green, unsigned long &blue, unsigned char *pixelMask)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i pixelBytes = _mm_setr_epi8(-1,0,0, -1,0,0, -1,0,0, -1,0,0, -1,0,0, 0); // first byte of each of 5 pixels
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i markMask = _mm_set1_epi8(ROI_MARK_MASK);
+    const __m128i redTreshold = _mm_set1_epi8(115);
+    const __m128i blueTreshold = _mm_set1_epi8(45);
+    const __m128i minMargin = _mm_set1_epi8(35);
+    const __m128i greenMargin = _mm_set1_epi8(25);
+    const __m128i calibMin = _mm_set1_epi8((char)classifier.greenMin());
+    const __m128i calibMax = _mm_set1_epi8((char)classifier.greenMax());
+    __m128i sumBlue = zero;
+    __m128i sumGreen = zero;
+    __m128i sumRed = zero;
+    __m128i sumArea = zero;
+
+    int i = 0;
+    for(; i + 6 <= length; i += 5) // the last load reads 16 bytes from 3*i + 2
+    {
+        unsigned char *p = row + 3*i;
+        __m128i vBlue = _mm_loadu_si128((const __m128i*)p);
+        __m128i vGreen = _mm_loadu_si128((const __m128i*)(p + 1));
+        __m128i vRed = _mm_loadu_si128((const __m128i*)(p + 2));
+
+        __m128i mask = pixelBytes;
+        if(flags & QRoiKernels::SkinPixels)
+        {
+            __m128i pass = _mm_min_epu8( _mm_subs_epu8(vRed, redTreshold), _mm_subs_epu8(vBlue, blueTreshold) );
+            pass = _mm_min_epu8( pass, _mm_subs_epu8(vRed, _mm_adds_epu8(_mm_min_epu8(vGreen, vBlue), minMargin)) );
+            pass = _mm_min_epu8( pass, _mm_subs_epu8(vRed, _mm_adds_epu8(vGreen, greenMargin)) ); // also means red > green
+            mask = _mm_andnot_si128(_mm_cmpeq_epi8(pass, zero), mask);
+        }
+        if(flags & QRoiKernels::CalibPixels)
+        {
+            __m128i inRange = _mm_and_si128( _mm_cmpeq_epi8(_mm_max_epu8(vGreen, calibMin), vGreen), _mm_cmpeq_epi8(_mm_min_epu8(vGreen, calibMax), vGreen) );
+            mask = _mm_and_si128(mask, inRange);
+        }
+
+        sumBlue = _mm_add_epi64(sumBlue, _mm_sad_epu8(_mm_and_si128(vBlue, mask), zero));
+        sumGreen = _mm_add_epi64(sumGreen, _mm_sad_epu8(_mm_and_si128(vGreen, mask), zero));
+        sumRed = _mm_add_epi64(sumRed, _mm_sad_epu8(_mm_and_si128(vRed, mask), zero));
+        sumArea = _mm_add_epi64(sumArea, _mm_sad_epu8(_mm_and_si128(ones, mask), zero));
+        if(pixelMask)
+        {
+            unsigned char temp[16];
+            _mm_storeu_si128((__m128i*)temp, mask);
+            for(int k = 0; k < 5; k++)
+            {
+                pixelMask[i + k] = temp[3*k];
+            }
+        }
+
+        if(flags & (QRoiKernels::MarkRed | QRoiKernels::MarkBlue))
+        {
+            __m128i marks = zero; // bytes of vBlue (the row itself) that should be marked
+            if(flags & QRoiKernels::MarkBlue)
+            {
+                marks = mask;
+            }
+            if(flags & QRoiKernels::MarkRed)
+            {
+                marks = _mm_or_si128(marks, _mm_slli_si128(mask, 2));
+            }
+            if(_mm_movemask_epi8(marks))
+            {
+                vBlue = _mm_or_si128( _mm_andnot_si128(marks, vBlue), _mm_and_si128(marks, _mm_and_si128(vBlue, markMask)) );
+                _mm_storeu_si128((__m128i*)p, vBlue); // byte 15 is the next pixel, it is written back unchanged
+            }
+        }
+    }
+
+    blue += (unsigned long)sumEpi64(sumBlue);
+    green += (unsigned long)sumEpi64(sumGreen);
+    red += (unsigned long)sumEpi64(sumRed);
+    return (unsigned long)sumEpi64(sumArea) + accumulateBGRScalar(row + 3*i, length - i, flags, classifier, red, green, blue, pixelMask ? pixelMask + i : NULL);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+ROI_TARGET_SSE2 static unsigned long accumulateGraySSE2(const unsigned char *row, int length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    int i = 0;
+    for(; i + 16 <= length; i += 16)
+    {
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(row + i)), zero));
+    }
+    return (unsigned long)sumEpi64(sum) + accumulateGrayScalar(row + i, length - i);
+}
+
+#ifdef ROI_AVX2
+//------------------------------------------------------------------------------------------------------
+
+ROI_TARGET_AVX2 static inline unsigned long long sumEpi64(__m256i value)
+{
+    unsigned long long temp[4];
+    _mm256_storeu_si256((__m256i*)temp, value);
+    return temp[0] + temp[1] + temp[2] + temp[3];
+}
+
+//------------------------------------------------------------------------------------------------------
+
+ROI_TARGET_AVX2 static unsigned long accumulateBGRAVX2(unsigned char *row, int length, int flags, const QColorClassifier &classifier, unsigned long &red, unsigned long &green, unsigned long &blue, unsigned char *pixelMask)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i pixelBytes = _mm256_setr_epi8(-1,0,0, -1,0,0, -1,0,0, -1,0,0, -1,0,0, -1,0,0, -1,0,0, -1,0,0, -1,0,0, -1,0,0, 0,0); // first byte of each of 10 pixels
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i markMask = _mm256_set1_epi8(ROI_MARK_MASK);
+    const __m256i redTreshold = _mm256_set1_epi8(115);
+    const __m256i blueTreshold = _mm256_set1_epi8(45);
+    const __m256i minMargin = _mm256_set1_epi8(35);
+    const __m256i greenMargin = _mm256_set1_epi8(25);
+    const __m256i calibMin = _mm256_set1_epi8((char)classifier.greenMin());
+    const __m256i calibMax = _mm256_set1_epi8((char)classifier.greenMax());
+    __m256i sumBlue = zero;
+    __m256i sumGreen = zero;
+    __m256i sumRed = zero;
+    __m256i sumArea = zero;
+
+    int i = 0;
+    for(; i + 12 <= length; i += 10) // the last load reads 32 bytes from 3*i + 2
+    {
+        unsigned char *p = row + 3*i;
+        __m256i vBlue = _mm256_loadu_si256((const __m256i*)p);
+        __m256i vGreen = _mm256_loadu_si256((const __m256i*)(p + 1));
+        __m256i vRed = _mm256_loadu_si256((const __m256i*)(p + 2));
+
+        __m256i mask = pixelBytes;
+        if(flags & QRoiKernels::SkinPixels)
+        {
+            __m256i pass = _mm256_min_epu8( _mm256_subs_epu8(vRed, redTreshold), _mm256_subs_epu8(vBlue, blueTreshold) );
+            pass = _mm256_min_epu8( pass, _mm256_subs_epu8(vRed, _mm256_adds_epu8(_mm256_min_epu8(vGreen, vBlue), minMargin)) );
+            pass = _mm256_min_epu8( pass, _mm256_subs_epu8(vRed, _mm256_adds_epu8(vGreen, greenMargin)) );
+            mask = _mm256_andnot_si256(_mm256_cmpeq_epi8(pass, zero), mask);
+        }
+        if(flags & QRoiKernels::CalibPixels)
+        {
+            __m256i inRange = _mm256_and_si256( _mm256_cmpeq_epi8(_mm256_max_epu8(vGreen, calibMin), vGreen), _mm256_cmpeq_epi8(_mm256_min_epu8(vGreen, calibMax), vGreen) );
+            mask = _mm256_and_si256(mask, inRange);
+        }
+
+        sumBlue = _mm256_add_epi64(sumBlue, _mm256_sad_epu8(_mm256_and_si256(vBlue, mask), zero));
+        sumGreen = _mm256_add_epi64(sumGreen, _mm256_sad_epu8(_mm256_and_si256(vGreen, mask), zero));
+        sumRed = _mm256_add_epi64(sumRed, _mm256_sad_epu8(_mm256_and_si256(vRed, mask), zero));
+        sumArea = _mm256_add_epi64(sumArea, _mm256_sad_epu8(_mm256_and_si256(ones, mask), zero));
+        if(pixelMask)
+        {
+            unsigned char temp[32];
+            _mm256_storeu_si256((__m256i*)temp, mask);
+            for(int k = 0; k < 10; k++)
+            {
+                pixelMask[i + k] = temp[3*k];
+            }
+        }
+
+        if(flags & (QRoiKernels::MarkRed | QRoiKernels::MarkBlue))
+        {
+            __m256i marks = zero;
+            if(flags & QRoiKernels::MarkBlue)
+            {
+                marks = mask;
+            }
+            if(flags & QRoiKernels::MarkRed)
+            {
+                // byte shift of the whole register by 2, _mm256_slli_si256 shifts 128-bit lanes separately
+                marks = _mm256_or_si256(marks, _mm256_alignr_epi8(mask, _mm256_permute2x128_si256(mask, mask, 0x08), 14));
+            }
+            if(_mm256_movemask_epi8(marks))
+            {
+                vBlue = _mm256_or_si256( _mm256_andnot_si256(marks, vBlue), _mm256_and_si256(marks, _mm256_and_si256(vBlue, markMask)) );
+                _mm256_storeu_si256((__m256i*)p, vBlue); // bytes 30 and 31 are the next pixel, they are written back unchanged
+            }
+        }
+    }
+
+    blue += (unsigned long)sumEpi64(sumBlue);
+    green += (unsigned long)sumEpi64(sumGreen);
+    red += (unsigned long)sumEpi64(sumRed);
+    return (unsigned long)sumEpi64(sumArea) + accumulateBGRScalar(row + 3*i, length - i, flags, classifier, red, green, blue, pixelMask ? pixelMask + i : NULL);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+ROI_TARGET_AVX2 static unsigned long accumulateGrayAVX2(const unsigned char *row, int length)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+    int i = 0;
+    for(; i + 32 <= length; i += 32)
+    {
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(row + i)), zero));
+    }
+    return (unsigned long)sumEpi64(sum) + accumulateGrayScalar(row + i, length - i);
+}
+#endif // ROI_AVX2
+
+//------------------------------------------------------------------------------------------------------
+
+static void cpuid(int leaf, int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+    int temp[4];
+    __cpuidex(temp, leaf, subleaf);
+    for(int i = 0; i < 4; i++)
+    {
+        registers[i] = (unsigned int)temp[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------
+
+static QRoiKernels::Instructions detectInstructions()
+{
+    unsigned int registers[4]; // eax, ebx, ecx, edx
+    cpuid(0, 0, registers);
+    unsigned int maxLeaf = registers[0];
+    if(maxLeaf < 1)
+    {
+        return QRoiKernels::ScalarInstructions;
+    }
+    cpuid(1, 0, registers);
+    if((registers[3] & (1u << 26)) == 0) // SSE2
+    {
+        return QRoiKernels::ScalarInstructions;
+    }
+#ifdef ROI_AVX2
+    bool osxsave = (registers[2] & (1u << 27)) != 0;
+    bool avx = (registers[2] & (1u << 28)) != 0;
+    if(osxsave && avx && (maxLeaf >= 7))
+    {
+        unsigned int xcr0;
+    #if defined(_MSC_VER)
+        xcr0 = (unsigned int)_xgetbv(0);
+    #else
+        unsigned int edx;
+        __asm__ ("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+    #endif
+        cpuid(7, 0, registers);
+        if(((xcr0 & 6) == 6) && (registers[1] & (1u << 5))) // OS saves YMM registers and CPU has AVX2
+        {
+            return QRoiKernels::AVX2Instructions;
+        }
+    }
+#endif
+    return QRoiKernels::SSE2Instructions;
+}
+#endif // ROI_X86
+
+//------------------------------------------------------------------------------------------------------
+
+static QRoiKernels::Instructions selectedInstructions =
+#ifdef ROI_X86
+        detectInstructions();
+#else
+        QRoiKernels::ScalarInstructions;
+#endif
+
+//------------------------------------------------------------------------------------------------------
+
+unsigned long QRoiKernels::accumulateBGR(unsigned char *row, int length, int flags, const QColorClassifier &classifier, unsigned long &red, unsigned long &green, unsigned long &blue, unsigned char *mask)
+{
+    if((flags & CalibPixels) && (classifier.greenMin() > classifier.greenMax()))
+    {
+        if(mask)
+        {
+            memset(mask, 0, length);
+        }
+        return 0;
+    }
+    if((flags & SkinPixels) && !classifier.isExactModifiedKovac())
+    {
+        return accumulateBGRScalar(row, length, flags, classifier, red, green, blue, mask);
+    }
+    switch(selectedInstructions)
+    {
+#ifdef ROI_X86
+    #ifdef ROI_AVX2
+        case AVX2Instructions:
+            return accumulateBGRAVX2(row, length, flags, classifier, red, green, blue, mask);
+    #endif
+        case SSE2Instructions:
+            return accumulateBGRSSE2(row, length, flags, classifier, red, green, blue, mask);
+#endif
+        default:
+            return accumulateBGRScalar(row, length, flags, classifier, red, green, blue, mask);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+static void addRowToColumns(const unsigned char *row, int first, int extended, int cols, int cn, int *sums, bool subtract)
+{
+    int begin = std::min(std::max(-first, 0), extended); // columns before begin are out of the image, they are mirrored as cv::blur(...) does
+    int end = std::max(std::min(cols - first, extended), begin); // columns from end are out of the image too
+    const unsigned char *p = row + cn*(first + begin);
+    int *s = sums + cn*begin;
+    int length = cn*(end - begin);
+    if(subtract)
+    {
+        for(int k = 0; k < length; k++)
+        {
+            s[k] -= p[k];
+        }
+    }
+    else
+    {
+        for(int k = 0; k < length; k++)
+        {
+            s[k] += p[k];
+        }
+    }
+    int sign = subtract ? -1 : 1;
+    for(int e = 0; e < begin; e++)
+    {
+        const unsigned char *mirrored = row + cn*cv::borderInterpolate(first + e, cols, cv::BORDER_REFLECT_101);
+        for(int c = 0; c < cn; c++)
+        {
+            sums[cn*e + c] += sign*mirrored[c];
+        }
+    }
+    for(int e = end; e < extended; e++)
+    {
+        const unsigned char *mirrored = row + cn*cv::borderInterpolate(first + e, cols, cv::BORDER_REFLECT_101);
+        for(int c = 0; c < cn; c++)
+        {
+            sums[cn*e + c] += sign*mirrored[c];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+unsigned long QRoiKernels::accumulateBlurred(const cv::Mat &image, const cv::Rect &region, const cv::Range *spans, int size, int flags, const QColorClassifier &classifier, unsigned long &red, unsigned long &green, unsigned long &blue, Buffers &buffers, int stride, unsigned long long *squares)
+{
+    Sums sums = {0, 0, 0, 0};
+    accumulateBlurredRegions(image, &region, &spans, 1, size, flags, classifier, &sums, buffers, stride, squares);
+    red += sums.red;
+    green += sums.green;
+    blue += sums.blue;
+    return sums.area;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+unsigned long QRoiKernels::accumulateBlurredRegions(const cv::Mat &image, const cv::Rect *regions, const cv::Range *const *spans, int count, int size, int flags, const QColorClassifier &classifier, Sums *sums, Buffers &buffers, int stride, unsigned long long *squares)
+{
+    cv::Rect bounding;
+    for(int i = 0; i < count; i++)
+    {
+        if(regions[i].area() > 0)
+        {
+            bounding = (bounding.area() > 0) ? (bounding | regions[i]) : regions[i];
+        }
+    }
+    if(bounding.area() <= 0)
+    {
+        return 0;
+    }
+    const int cn = image.channels();
+    const int anchor = size / 2; // the same anchor as cv::blur(...) uses by default
+    const int first = bounding.x - anchor; // image column of the first column sum
+    const int extended = bounding.width + size - 1; // column sums that take part in the box filter of the bounding rect
+    const double scale = 1.0 / (size*size); // the same scale and rounding as cv::blur(...) uses for 8-bit images, so the smoothed values match it exactly
+    const bool masked = (cn == 3) && (flags & (MarkRed | MarkBlue));
+    const bool compactMask = (cn == 3) && (squares || (masked && (stride > 1))); // mask of the sampled pixels only
+    const bool clearMask = masked && ((count > 1) || (stride > 1) || (spans && spans[0])); // accumulateBGR(...) does not write every mask pixel of the row
+    stride = stride > 1 ? stride : 1;
+    const int phaseStep = stride / 2; // phase of the samples shifts from row to row: checkerboard for stride 2
+
+    buffers.columnSums.assign(cn*extended, 0);
+    buffers.row.resize(cn*bounding.width);
+    if(masked)
+    {
+        buffers.mask.create(bounding.height, bounding.width, CV_8UC1);
+    }
+    if(compactMask)
+    {
+        buffers.rowMask.resize(bounding.width);
+    }
+    int *columnSums = &buffers.columnSums[0];
+    unsigned char *blurred = &buffers.row[0];
+
+    for(int r = bounding.y - anchor; r < bounding.y - anchor + size; r++)
+    {
+        addRowToColumns(image.ptr(cv::borderInterpolate(r, image.rows, cv::BORDER_REFLECT_101)), first, extended, image.cols, cn, columnSums, false);
+    }
+
+    unsigned long area = 0;
+    for(int y = bounding.y; y < bounding.y + bounding.height; y++)
+    {
+        unsigned char *mask = masked ? buffers.mask.ptr(y - bounding.y) : NULL;
+        if(clearMask)
+        {
+            memset(mask, 0, bounding.width);
+        }
+        // column sums are shared, so every row of the image is added once whatever number of regions covers it
+        for(int i = 0; i < count; i++)
+        {
+            const cv::Rect &region = regions[i];
+            if((region.area() <= 0) || (y < region.y) || (y >= region.y + region.height))
+            {
+                continue;
+            }
+            int left = (spans && spans[i]) ? spans[i][y - region.y].start : region.x;
+            int right = (spans && spans[i]) ? spans[i][y - region.y].end : region.x + region.width;
+            if(right <= left)
+            {
+                continue;
+            }
+            // horizontal sums of column sums slide along the row, each step adds one column and drops one
+            int window[3] = {0, 0, 0};
+            const int *column = columnSums + cn*(left - bounding.x);
+            for(int k = 0; k < cn*size; k++)
+            {
+                window[k % cn] += column[k];
+            }
+            int next = (stride - (left + y*phaseStep) % stride) % stride; // offset of the first sample, samples are bound to image coordinates
+            int samples = 0;
+            for(int x = 0; x < right - left; x++)
+            {
+                if(x == next)
+                {
+                    for(int c = 0; c < cn; c++)
+                    {
+                        blurred[cn*samples + c] = cv::saturate_cast<unsigned char>(window[c]*scale);
+                    }
+                    samples++;
+                    next += stride;
+                }
+                if(x + 1 < right - left)
+                {
+                    for(int c = 0; c < cn; c++)
+                    {
+                        window[c] += column[cn*(x + size) + c] - column[cn*x + c];
+                    }
+                }
+            }
+            unsigned long long *regionSquares = squares ? squares + 3*i : NULL;
+            unsigned long enrolled = 0;
+            if(cn == 3)
+            {
+                unsigned char *samplesMask = compactMask ? &buffers.rowMask[0] : (mask ? mask + (left - bounding.x) : NULL);
+                enrolled = accumulateBGR(blurred, samples, flags & ~(MarkRed | MarkBlue), classifier, sums[i].red, sums[i].green, sums[i].blue, samplesMask);
+                if(compactMask)
+                {
+                    int offset = (stride - (left + y*phaseStep) % stride) % stride;
+                    for(int k = 0; k < samples; k++)
+                    {
+                        if(samplesMask[k] == 0)
+                        {
+                            continue;
+                        }
+                        if(mask)
+                        {
+                            mask[left - bounding.x + offset + k*stride] = 255;
+                        }
+                        if(regionSquares)
+                        {
+                            const unsigned char *p = blurred + 3*k;
+                            regionSquares[0] += p[0]*p[0];
+                            regionSquares[1] += p[1]*p[1];
+                            regionSquares[2] += p[2]*p[2];
+                        }
+                    }
+                }
+            }
+            else
+            {
+                sums[i].green += accumulateGray(blurred, samples);
+                enrolled = samples;
+                if(regionSquares)
+                {
+                    for(int k = 0; k < samples; k++)
+                    {
+                        regionSquares[1] += blurred[k]*blurred[k];
+                    }
+                }
+            }
+            sums[i].area += enrolled;
+            area += enrolled;
+        }
+        if(y + 1 < bounding.y + bounding.height)
+        {
+            addRowToColumns(image.ptr(cv::borderInterpolate(y - anchor, image.rows, cv::BORDER_REFLECT_101)), first, extended, image.cols, cn, columnSums, true);
+            addRowToColumns(image.ptr(cv::borderInterpolate(y - anchor + size, image.rows, cv::BORDER_REFLECT_101)), first, extended, image.cols, cn, columnSums, false);
+        }
+    }
+
+    return area;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+unsigned long QRoiKernels::accumulateGray(const unsigned char *row, int length)
+{
+    switch(selectedInstructions)
+    {
+#ifdef ROI_X86
+    #ifdef ROI_AVX2
+        case AVX2Instructions:
+            return accumulateGrayAVX2(row, length);
+    #endif
+        case SSE2Instructions:
+            return accumulateGraySSE2(row, length);
+#endif
+        default:
+            return accumulateGrayScalar(row, length);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QRoiKernels::Instructions QRoiKernels::instructions()
+{
+    return selectedInstructions;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+const char *QRoiKernels::instructionsName()
+{
+    switch(selectedInstructions)
+    {
+        case AVX2Instructions:
+            return "AVX2";
+        case SSE2Instructions:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,88 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QRoiKernels holds the inner loops of ROI accumulation for BGR and grayscale frames: skin (and calibration
+colour) classification, masked summation of the colour channels and enrolled area counting, marking of
+the enrolled pixels on the image. Every function except accumulateBlurred(...) and
+accumulateBlurredRegions(...) processes one image row. SSE2 and AVX2 versions classify 5 or 10 pixels
+at a time without branches, the version is selected at startup by cpuid.
+All versions give bit-identical sums and marks, the scalar one is the reference. SIMD versions are used
+for the Modified Kovac's rule only, other rules of QColorClassifier are looked up by the scalar version.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QROIKERNELS_H
+#define QROIKERNELS_H
+//------------------------------------------------------------------------------------------------------
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#define ROI_MARK_MASK 31 // the same as OVERLAY_MARK_MASK in qroioverlay.h, value %= 32 leaves 5 low bits
+
+//------------------------------------------------------------------------------------------------------
+
+class QColorClassifier;
+
+class QRoiKernels
+{
+public:
+    enum Flags
+    {
+        AllPixels = 0,          // every pixel is enrolled
+        SkinPixels = 1,         // only pixels that pass QColorClassifier::isSkin(...)
+        CalibPixels = 2,        // only pixels that pass QColorClassifier::isCalib(...)
+        MarkRed = 4,            // red of enrolled pixels is reduced modulo 32 to show them on the image
+        MarkBlue = 8            // blue of enrolled pixels is reduced modulo 32
+    };
+
+    enum Instructions { ScalarInstructions, SSE2Instructions, AVX2Instructions };
+
+    struct Sums                 // sums of one region of accumulateBlurredRegions(...)
+    {
+        unsigned long red;
+        unsigned long green;
+        unsigned long blue;
+        unsigned long area;     // enrolled pixels
+    };
+
+    struct Buffers              // scratch memory of accumulateBlurred(...), it is reused from frame to frame
+    {
+        std::vector<int> columnSums;
+        std::vector<unsigned char> row;
+        std::vector<unsigned char> rowMask;     // enrolled samples of the row
+        cv::Mat mask;           // enrolled pixels of the last region, 255 - enrolled, 0 - not, caller can point it to memory of the region size
+    };
+
+    // sums colours of enrolled pixels of BGR row of length pixels into red, green and blue, returns number of enrolled pixels
+    // if mask is not NULL, mask[i] is set to 255 for enrolled and to 0 for other pixels
+    static unsigned long accumulateBGR(unsigned char *row, int length, int flags, const QColorClassifier &classifier, unsigned long &red, unsigned long &green, unsigned long &blue, unsigned char *mask = NULL);
+    // the same for region of BGR or grayscale image smoothed by size x size box filter on the fly, the image is not changed,
+    // MarkRed or MarkBlue ask for buffers.mask of the enrolled pixels of the region instead of marks,
+    // spans (if not NULL) limit row y of the region to columns [spans[y - region.y].start, spans[y - region.y].end),
+    // pixels out of the image are mirrored (BORDER_REFLECT_101) and the box mean is rounded as cv::blur(...) does, so smoothed values are the same, for grayscale image the sum goes to green and all pixels are enrolled,
+    // only pixel x of row y with (x + y*(stride/2)) % stride == 0 is taken: checkerboard for stride 2, every 4th pixel with phase 0, 2, 0, 2 for stride 4,
+    // squares (if not NULL) accumulates squares of blue, green and red of the enrolled pixels
+    static unsigned long accumulateBlurred(const cv::Mat &image, const cv::Rect &region, const cv::Range *spans, int size, int flags, const QColorClassifier &classifier, unsigned long &red, unsigned long &green, unsigned long &blue, Buffers &buffers,
+                                           int stride = 1, unsigned long long *squares = NULL);
+    // the same for count regions in one pass: box filter is computed once for the bounding rect of the regions and each region adds to its own sums[i],
+    // spans[i] (if spans and spans[i] are not NULL) limit rows of region i, buffers.mask covers the bounding rect, squares (if not NULL) holds 3 values per region,
+    // returns number of enrolled pixels of all regions, a pixel of overlapped regions is counted for each of them
+    static unsigned long accumulateBlurredRegions(const cv::Mat &image, const cv::Rect *regions, const cv::Range *const *spans, int count, int size, int flags, const QColorClassifier &classifier, Sums *sums, Buffers &buffers,
+                                                  int stride = 1, unsigned long long *squares = NULL);
+    static unsigned long accumulateGray(const unsigned char *row, int length); // returns sum of the row values
+    static Instructions instructions();         // version that is used by accumulateBGR(...) and accumulateGray(...)
+    static const char *instructionsName();
+    static bool isSkin(unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue); // Modified Kovac's rule, SIMD versions evaluate it directly
+};
+
+//------------------------------------------------------------------------------------------------------
+
+inline bool QRoiKernels::isSkin(unsigned char valueRed, unsigned char valueGreen, unsigned char valueBlue)
+{
+    return (valueRed > 115) &&
+           (valueRed > valueGreen) && (valueBlue > 45) &&
+           ((valueRed - (valueGreen < valueBlue ? valueGreen : valueBlue)) > 35) &&
+           ((valueRed - valueGreen) > 25);
+}
+
+//------------------------------------------------------------------------------------------------------
+#endif // QROIKERNELS_H
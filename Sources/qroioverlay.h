@@ -0,0 +1,43 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QRoiOverlay carries the highlight of the processed region from QOpencvProcessor to QImageWidget:
+run-length spans of the enrolled pixels and the outline of the region. The frame itself stays intact,
+so its buffer can be shared by other consumers without a copy. QImageWidget composites the overlay on
+its own RGB copy of the frame and only while the image is shown. Run array is implicitly shared.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QROIOVERLAY_H
+#define QROIOVERLAY_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QVector>
+#include <opencv2/opencv.hpp>
+
+#define OVERLAY_MARK_MASK 31 // marked value %= 32 leaves 5 low bits
+
+//------------------------------------------------------------------------------------------------------
+
+struct QRoiRun
+{
+    int row;
+    int start;              // first enrolled column
+    int end;                // column after the last enrolled one
+};
+
+struct QRoiOverlay
+{
+    enum Marks
+    {
+        NoMarks = 0,
+        MarkRed = 1,        // red of the enrolled pixels is reduced modulo 32, whole pixel for grayscale frames
+        MarkBlue = 2        // blue of the enrolled pixels is reduced modulo 32
+    };
+
+    QVector<QRoiRun> runs;  // enrolled pixels in frame coordinates
+    int marks;
+    cv::Rect outline;       // empty if there is no outline
+    cv::Scalar outlineColor;    // in channel order of the frame
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QROIOVERLAY_H
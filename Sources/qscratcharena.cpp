@@ -0,0 +1,38 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QScratchArena keeps the scratch buffers of the frame path from being reallocated on every frame. Owner of
+the scratch buffers asks the arena for a header of the size it needs now, the buffer itself is allocated
+with the capacity size (usually the frame size), so it is reallocated only when the frame size or the mode
+changes. Every resize of an arena buffer is counted, the counter should stay the same while frames of the
+same size are processed. It counts the arena buffers only, OpenCV calls and containers outside of the
+arena may still allocate, so a steady counter is not a proof of an allocation-free frame.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qscratcharena.h"
+
+//------------------------------------------------------------------------------------------------------
+
+QScratchArena::QScratchArena():
+    m_resizes(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+cv::Mat QScratchArena::mat(cv::Mat &memory, const cv::Size &capacity, const cv::Size &size, int type)
+{
+    if((memory.size() != capacity) || (memory.type() != type))
+    {
+        memory.create(capacity, type);
+        m_resizes++;
+    }
+    // OpenCV functions call create(...) for the output, it does nothing for the header of the same size and type
+    return memory(cv::Rect(0, 0, qMin(size.width, capacity.width), qMin(size.height, capacity.height)));
+}
+
+//------------------------------------------------------------------------------------------------------
+
+quint32 QScratchArena::resizes() const
+{
+    return m_resizes;
+}
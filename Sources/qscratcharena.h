@@ -0,0 +1,47 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QScratchArena keeps the scratch buffers of the frame path from being reallocated on every frame. Owner of
+the scratch buffers asks the arena for a header of the size it needs now, the buffer itself is allocated
+with the capacity size (usually the frame size), so it is reallocated only when the frame size or the mode
+changes. Every resize of an arena buffer is counted, the counter should stay the same while frames of the
+same size are processed. It counts the arena buffers only, OpenCV calls and containers outside of the
+arena may still allocate, so a steady counter is not a proof of an allocation-free frame.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QSCRATCHARENA_H
+#define QSCRATCHARENA_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QtGlobal>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//------------------------------------------------------------------------------------------------------
+
+class QScratchArena
+{
+public:
+    QScratchArena();
+
+    // returns header of size at the top-left corner of memory, memory is allocated with capacity size if it has other size or type
+    cv::Mat mat(cv::Mat &memory, const cv::Size &capacity, const cv::Size &size, int type);
+    template<typename T> void reserve(std::vector<T> &vector, size_t capacity); // vector memory only grows, so resize(...) up to capacity does not allocate
+    quint32 resizes() const;    // number of arena buffer resizes since construction
+
+private:
+    quint32 m_resizes;
+};
+
+//------------------------------------------------------------------------------------------------------
+
+template<typename T> inline void QScratchArena::reserve(std::vector<T> &vector, size_t capacity)
+{
+    if(vector.capacity() < capacity)
+    {
+        vector.reserve(capacity);
+        m_resizes++;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+#endif // QSCRATCHARENA_H
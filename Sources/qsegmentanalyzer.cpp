@@ -0,0 +1,427 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QSegmentAnalyzer measures a long video file offline. The file is split into time segments, each segment
+is decoded and processed by QSegmentWorker in its own thread. A worker starts m_DataLength frames before
+its segment (warm-up), so buffers of its QHarmonicProcessor are primed when the segment begins, warm-up
+measurements are not recorded. Estimations are made on the common grid of video time, so when all
+workers have finished the records are simply stitched in segment order.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qsegmentanalyzer.h"
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <climits>
+#include <cmath>
+
+#define PROGRESS_STEP 64 // frames between progress(...) emissions
+
+//------------------------------------------------------------------------------------------------------
+
+QSegmentWorker::QSegmentWorker(quint16 id, const QString &filename, int first_frame, int last_frame):
+    QObject(NULL),
+    m_id(id),
+    m_filename(filename),
+    m_firstFrame(first_frame),
+    m_lastFrame(last_frame),
+    m_dataLength(256),
+    m_bufferLength(256),
+    m_fftFlag(true),
+    m_period(DEFAULT_SEGMENT_ESTIMATION_PERIOD),
+    m_timestamp(0.0),
+    m_abortFlag(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentWorker::setProcessing(const QString &cascade, const cv::Rect &rect)
+{
+    m_cascade = cascade;
+    m_rect = rect;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentWorker::setHarmonic(quint16 length_of_data, quint16 length_of_buffer, bool fft, double period)
+{
+    m_dataLength = length_of_data;
+    m_bufferLength = length_of_buffer;
+    m_fftFlag = fft;
+    m_period = (period > 0.0) ? period : DEFAULT_SEGMENT_ESTIMATION_PERIOD;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentWorker::abort()
+{
+    m_abortFlag.store(1);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+const QVector<QSegmentWorker::Record> &QSegmentWorker::records() const
+{
+    return v_records;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSegmentWorker::openSource(int &frame)
+{
+    if(QSyntheticVideo::isSupported(m_filename))
+    {
+        return m_syntheticVideo.open(m_filename) && m_syntheticVideo.seek(frame);
+    }
+    if(QMappedVideo::isSupported(m_filename))
+    {
+        return m_mappedVideo.open(m_filename) && m_mappedVideo.seek(frame);
+    }
+    if(!m_cvCapture.open(m_filename.toLocal8Bit().constData()))
+    {
+        return false;
+    }
+    if(frame > 0)
+    {
+        m_cvCapture.set(CV_CAP_PROP_POS_FRAMES, frame);
+        double position = m_cvCapture.get(CV_CAP_PROP_POS_FRAMES); // the seek may snap to a keyframe, so frames are counted from where the decoder really is
+        if(position >= 0.0)
+        {
+            frame = cvRound(position);
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSegmentWorker::readFrame(cv::Mat &frame, double &timestamp)
+{
+    if(m_mappedVideo.isOpened())
+    {
+        if(m_mappedVideo.read(frame))
+        {
+            timestamp = m_mappedVideo.timestamp();
+            return true;
+        }
+        return false;
+    }
+    if(m_syntheticVideo.isOpened())
+    {
+        if(m_syntheticVideo.read(frame))
+        {
+            timestamp = m_syntheticVideo.timestamp();
+            return true;
+        }
+        return false;
+    }
+    if(m_cvCapture.read(frame) && !frame.empty())
+    {
+        timestamp = m_cvCapture.get(CV_CAP_PROP_POS_MSEC);
+        return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentWorker::process()
+{
+    int warmStart = qMax(0, m_firstFrame - (int)m_dataLength);
+    int position = warmStart;
+    if(openSource(position))
+    {
+        //--------------------The same pipeline as in the main window-----
+        QFrameRing ring(1); // frames go through the ring only to carry their timestamps to the processor
+        QOpencvProcessor processor;
+        QHarmonicProcessor harmonic(NULL, m_dataLength, m_bufferLength);
+        processor.setFrameRing(&ring);
+        if(!m_cascade.isEmpty() && processor.loadClassifier(m_cascade.toStdString()))
+        {
+            connect(&processor, SIGNAL(frameDequeued(cv::Mat)), &processor, SLOT(faceProcess(cv::Mat)), Qt::DirectConnection);
+        }
+        else
+        {
+            processor.setRect(m_rect);
+            connect(&processor, SIGNAL(frameDequeued(cv::Mat)), &processor, SLOT(rectProcess(cv::Mat)), Qt::DirectConnection);
+        }
+        connect(&processor, SIGNAL(dataCollected(ulong,ulong,ulong,ulong,double)), &harmonic, SLOT(EnrollData(ulong,ulong,ulong,ulong,double)), Qt::DirectConnection);
+        connect(&harmonic, SIGNAL(measurementsUpdated(qreal,qreal,qreal,qreal)), this, SLOT(storeMeasurements(qreal,qreal,qreal,qreal)), Qt::DirectConnection);
+
+        double nextEstimation = -1.0;
+        for(int n = position; (n < m_lastFrame) && (m_abortFlag.load() == 0); n++)
+        {
+            QFrameRing::Slot *slot = ring.writeSlot();
+            if(!readFrame(slot->frame, m_timestamp))
+            {
+                break;
+            }
+            slot->format = QFrameRing::BGRFormat;
+            slot->captureTime = 0.0;
+            slot->timestamp = m_timestamp;
+            ring.commit();
+            processor.processQueuedFrames();
+
+            if(n >= m_firstFrame)
+            {
+                if(nextEstimation < 0.0)
+                {
+                    nextEstimation = std::ceil(m_timestamp / m_period) * m_period; // the grid is common for all segments
+                }
+                if(m_timestamp >= nextEstimation)
+                {
+                    if(m_fftFlag)
+                    {
+                        harmonic.computeHeartRate();
+                    }
+                    else
+                    {
+                        harmonic.CountFrequency();
+                    }
+                    harmonic.computeBreathRate(); // emits measurementsUpdated(...)
+                    while(nextEstimation <= m_timestamp)
+                    {
+                        nextEstimation += m_period;
+                    }
+                }
+            }
+            if(((n - position) % PROGRESS_STEP) == 0)
+            {
+                emit progress(m_id, qMax(0, n - warmStart));
+            }
+        }
+        m_cvCapture.release();
+        m_mappedVideo.close();
+        m_syntheticVideo.close();
+    }
+    else
+    {
+        qWarning("QSegmentWorker: can not open %s", m_filename.toLocal8Bit().constData());
+    }
+    emit finished(m_id);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentWorker::storeMeasurements(qreal heart_rate, qreal heart_snr, qreal breath_rate, qreal breath_snr)
+{
+    Record record;
+    record.timestamp = m_timestamp;
+    record.heartRate = heart_rate;
+    record.heartSNR = heart_snr;
+    record.breathRate = breath_rate;
+    record.breathSNR = breath_snr;
+    v_records.append(record);
+}
+
+//======================================================================================================
+
+QSegmentAnalyzer::QSegmentAnalyzer(QObject *parent):
+    QObject(parent),
+    m_dataLength(256),
+    m_bufferLength(256),
+    m_fftFlag(true),
+    m_period(DEFAULT_SEGMENT_ESTIMATION_PERIOD),
+    m_segments(0),
+    m_finished(0),
+    m_abortedFlag(false),
+    m_totalFrames(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QSegmentAnalyzer::~QSegmentAnalyzer()
+{
+    abort();
+    clear();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentAnalyzer::setProcessing(const QString &cascade, const cv::Rect &rect)
+{
+    m_cascade = cascade;
+    m_rect = rect;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentAnalyzer::setHarmonic(quint16 length_of_data, quint16 length_of_buffer, bool fft, double period)
+{
+    m_dataLength = length_of_data;
+    m_bufferLength = length_of_buffer;
+    m_fftFlag = fft;
+    m_period = period;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSegmentAnalyzer::isRunning() const
+{
+    return !v_workers.isEmpty();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSegmentAnalyzer::start(const QString &filename, const QString &record, quint16 segments)
+{
+    if(isRunning())
+    {
+        return false;
+    }
+
+    int frames = 0;
+    if(QSyntheticVideo::isSupported(filename))
+    {
+        QSyntheticVideo video;
+        if(!video.open(filename))
+        {
+            return false;
+        }
+        frames = video.frameCount();
+    }
+    else if(QMappedVideo::isSupported(filename))
+    {
+        QMappedVideo video;
+        if(!video.open(filename))
+        {
+            return false;
+        }
+        frames = video.frameCount();
+    }
+    else
+    {
+        cv::VideoCapture capture(filename.toLocal8Bit().constData());
+        if(!capture.isOpened())
+        {
+            return false;
+        }
+        frames = (int)capture.get(CV_CAP_PROP_FRAME_COUNT);
+    }
+
+    m_segments = (segments > 0) ? segments : QThread::idealThreadCount();
+    if(frames > 0)
+    {
+        m_segments = qMin((int)m_segments, qMax(1, frames / (int)m_dataLength)); // segment shorter than the warm-up is a waste of time
+    }
+    else
+    {
+        m_segments = 1; // unknown length, the file can not be split
+    }
+
+    m_record = record;
+    m_finished = 0;
+    m_abortedFlag = false;
+    m_totalFrames = 0;
+    v_progress.fill(0, m_segments);
+    for(quint16 i = 0; i < m_segments; i++)
+    {
+        int first = (frames > 0) ? (int)((qint64)i * frames / m_segments) : 0;
+        int last = (frames > 0) ? (int)((qint64)(i + 1) * frames / m_segments) : INT_MAX;
+        m_totalFrames += (frames > 0) ? last - qMax(0, first - (int)m_dataLength) : 0;
+
+        QSegmentWorker *worker = new QSegmentWorker(i, filename, first, last);
+        worker->setProcessing(m_cascade, m_rect);
+        worker->setHarmonic(m_dataLength, m_bufferLength, m_fftFlag, m_period);
+        QThread *thread = new QThread(this);
+        worker->moveToThread(thread);
+        connect(this, SIGNAL(startWorkers()), worker, SLOT(process()));
+        connect(worker, SIGNAL(progress(quint16,int)), this, SLOT(updateProgress(quint16,int)));
+        connect(worker, SIGNAL(finished(quint16)), this, SLOT(workerFinished(quint16)));
+        thread->start();
+        v_workers.append(worker);
+        v_threads.append(thread);
+    }
+    emit startWorkers();
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentAnalyzer::abort()
+{
+    m_abortedFlag = isRunning();
+    for(int i = 0; i < v_workers.size(); i++)
+    {
+        v_workers[i]->abort();
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentAnalyzer::updateProgress(quint16 id, int frames)
+{
+    if((id >= v_progress.size()) || (m_totalFrames <= 0))
+    {
+        return;
+    }
+    v_progress[id] = frames;
+    qint64 sum = 0;
+    for(int i = 0; i < v_progress.size(); i++)
+    {
+        sum += v_progress[i];
+    }
+    emit progressUpdated((int)(100 * sum / m_totalFrames));
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentAnalyzer::workerFinished(quint16 id)
+{
+    Q_UNUSED(id);
+    m_finished++;
+    if(m_finished == m_segments)
+    {
+        bool success = !m_abortedFlag && writeRecord(); // a record with gaps is not written
+        clear();
+        emit analysisFinished(success);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSegmentAnalyzer::writeRecord()
+{
+    QFile file(m_record);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+    QTextStream stream(&file);
+    stream.setRealNumberNotation(QTextStream::FixedNotation);
+    stream.setRealNumberPrecision(3);
+    stream << "QPULSECAPTURE ANALYSIS RECORD of " << QDateTime::currentDateTime().toString("dd.MM.yyyy")
+           << "\nSegments: " << m_segments
+           << "\nVideo time, s\tHeartRate, bpm\tSNR, dB\tBreathRate, rpm\tSNR, dB\n";
+    for(int i = 0; i < v_workers.size(); i++) // workers are stored in time order
+    {
+        const QVector<QSegmentWorker::Record> &records = v_workers[i]->records();
+        for(int j = 0; j < records.size(); j++)
+        {
+            stream << records[j].timestamp / 1000.0
+                   << "\t" << qRound(records[j].heartRate) << "\t"
+                   << records[j].heartSNR << "\t" << qRound(records[j].breathRate)
+                   << "\t" << records[j].breathSNR << "\n";
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSegmentAnalyzer::clear()
+{
+    for(int i = 0; i < v_threads.size(); i++)
+    {
+        v_threads[i]->quit();
+    }
+    for(int i = 0; i < v_threads.size(); i++)
+    {
+        v_threads[i]->wait();
+        delete v_workers[i];
+        delete v_threads[i];
+    }
+    v_workers.clear();
+    v_threads.clear();
+}
@@ -0,0 +1,128 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QSegmentAnalyzer measures a long video file offline. The file is split into time segments, each segment
+is decoded and processed by QSegmentWorker in its own thread. A worker starts m_DataLength frames before
+its segment (warm-up), so buffers of its QHarmonicProcessor are primed when the segment begins, warm-up
+measurements are not recorded. Estimations are made on the common grid of video time, so when all
+workers have finished the records are simply stitched in segment order.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QSEGMENTANALYZER_H
+#define QSEGMENTANALYZER_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QVector>
+#include <QAtomicInt>
+#include <opencv2/opencv.hpp>
+
+#include "qframering.h"
+#include "qmappedvideo.h"
+#include "qsyntheticvideo.h"
+#include "qopencvprocessor.h"
+#include "qharmonicprocessor.h"
+
+#define DEFAULT_SEGMENT_ESTIMATION_PERIOD 1000.0 // ms of video time between estimations
+
+//------------------------------------------------------------------------------------------------------
+
+class QSegmentWorker : public QObject
+{
+    Q_OBJECT
+public:
+    struct Record
+    {
+        double timestamp;   // video time of the estimation, in ms
+        qreal heartRate;
+        qreal heartSNR;
+        qreal breathRate;
+        qreal breathSNR;
+    };
+
+    QSegmentWorker(quint16 id, const QString &filename, int first_frame, int last_frame);
+    void setProcessing(const QString &cascade, const cv::Rect &rect); // cascade is used if it is not empty, rect otherwise
+    void setHarmonic(quint16 length_of_data, quint16 length_of_buffer, bool fft, double period);
+    void abort();   // can be called from any thread
+    const QVector<Record> &records() const; // valid after finished(...)
+
+signals:
+    void progress(quint16 id, int frames);  // frames processed by this worker including warm-up
+    void finished(quint16 id);
+
+public slots:
+    void process();     // decodes and processes the segment, returns when it is done
+
+private:
+    quint16 m_id;
+    QString m_filename;
+    int m_firstFrame;
+    int m_lastFrame;    // frame after the last frame of the segment
+    QString m_cascade;
+    cv::Rect m_rect;
+    quint16 m_dataLength;
+    quint16 m_bufferLength;
+    bool m_fftFlag;
+    double m_period;
+    double m_timestamp;     // timestamp of the current frame
+    QAtomicInt m_abortFlag;
+    QVector<Record> v_records;
+
+    cv::VideoCapture m_cvCapture;
+    QMappedVideo m_mappedVideo;
+    QSyntheticVideo m_syntheticVideo;
+    bool openSource(int &frame);   // frame is set to the position the source has really reached
+    bool readFrame(cv::Mat &frame, double &timestamp);
+
+private slots:
+    void storeMeasurements(qreal heart_rate, qreal heart_snr, qreal breath_rate, qreal breath_snr);
+};
+
+//------------------------------------------------------------------------------------------------------
+
+class QSegmentAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QSegmentAnalyzer(QObject *parent = 0);
+    ~QSegmentAnalyzer();
+
+signals:
+    void progressUpdated(int percent);
+    void analysisFinished(bool success);   // the record is written when this signal is emitted
+    void startWorkers();
+
+public slots:
+    bool start(const QString &filename, const QString &record, quint16 segments = 0); // segments = 0 means QThread::idealThreadCount()
+    void abort();
+    void setProcessing(const QString &cascade, const cv::Rect &rect);
+    void setHarmonic(quint16 length_of_data, quint16 length_of_buffer, bool fft, double period = DEFAULT_SEGMENT_ESTIMATION_PERIOD);
+    bool isRunning() const;
+
+private:
+    QString m_record;
+    QString m_cascade;
+    cv::Rect m_rect;
+    quint16 m_dataLength;
+    quint16 m_bufferLength;
+    bool m_fftFlag;
+    double m_period;
+    quint16 m_segments;
+    quint16 m_finished;
+    bool m_abortedFlag;
+    int m_totalFrames;      // frames to be decoded by all workers including warm-up
+    QVector<int> v_progress;
+    QVector<QSegmentWorker*> v_workers;
+    QVector<QThread*> v_threads;
+
+    bool writeRecord();
+    void clear();
+
+private slots:
+    void updateProgress(quint16 id, int frames);
+    void workerFinished(quint16 id);
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QSEGMENTANALYZER_H
@@ -0,0 +1,287 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QStreamManager runs several independent capture -> ROI -> harmonic pipelines in one process. Every
+stream has its own QVideoCapture thread, QFrameRing, QOpencvProcessor and QHarmonicProcessor, image and
+harmonic processors of all streams share a pool of worker threads (round-robin assignment, like
+QHarmonicProcessorMap does for the map cells). ROI is found by face detection, so a cascade is needed.
+Each stream writes its own measurements record, the last column is a share of one CPU core that was
+spent on capture and image processing of the stream since the previous record.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qstreammanager.h"
+#include <QTime>
+#include <QDateTime>
+
+//------------------------------------------------------------------------------------------------------
+
+QStreamManager::QStreamManager(QObject *parent, quint16 threads, quint16 length_of_data, quint16 length_of_buffer):
+    QObject(parent),
+    m_dataLength(length_of_data),
+    m_bufferLength(length_of_buffer)
+{
+    m_threadCount = (threads > 0) ? threads : QThread::idealThreadCount();
+    if(m_threadCount == 0)
+    {
+        m_threadCount = 1;
+    }
+    v_threads = new QThread[m_threadCount];
+    for(quint16 i = 0; i < m_threadCount; i++)
+    {
+        v_threads[i].start();
+    }
+
+    m_clock.start();
+    m_timer.setInterval(DEFAULT_STREAM_ESTIMATION_PERIOD);
+    connect(&m_timer, SIGNAL(timeout()), this, SIGNAL(updateStreams()));
+    m_timer.start();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QStreamManager::~QStreamManager()
+{
+    m_timer.stop();
+    // processors can be inside processQueuedFrames() on a slot that points into the file mapping of the capture,
+    // so worker threads are finished before any capture closes its file
+    for(quint16 i = 0; i < m_threadCount; i++)
+    {
+        v_threads[i].quit();
+    }
+    for(quint16 i = 0; i < m_threadCount; i++)
+    {
+        v_threads[i].wait();
+    }
+    for(int i = 0; i < v_streams.size(); i++)
+    {
+        stopCapture(v_streams[i]);
+    }
+    for(int i = 0; i < v_streams.size(); i++) // worker threads are finished, so objects that live there can be deleted directly
+    {
+        delete v_streams[i].pt_processor;
+        delete v_streams[i].pt_harmonic;
+        delete v_streams[i].pt_ring;
+        delete v_streams[i].pt_textStream;
+        delete v_streams[i].pt_file;
+    }
+    delete[] v_threads;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QStreamManager::createStream(const QString &source, const QString &cascade, const QString &record)
+{
+    Stream stream;
+    stream.source = source;
+    stream.m_busyTime = 0.0;
+    stream.m_recordTime = m_clock.elapsed();
+
+    stream.pt_processor = new QOpencvProcessor();
+    if(!stream.pt_processor->loadClassifier(cascade.toStdString()))
+    {
+        qWarning("QStreamManager: can not load classifier %s", cascade.toLocal8Bit().constData());
+        delete stream.pt_processor;
+        return -1;
+    }
+    stream.pt_file = new QFile(record);
+    if(!stream.pt_file->open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        qWarning("QStreamManager: can not open %s", record.toLocal8Bit().constData());
+        delete stream.pt_file;
+        delete stream.pt_processor;
+        return -1;
+    }
+    stream.pt_textStream = new QTextStream(stream.pt_file);
+    stream.pt_textStream->setRealNumberNotation(QTextStream::FixedNotation);
+    stream.pt_textStream->setRealNumberPrecision(3);
+    *stream.pt_textStream << "QPULSECAPTURE MEASUREMENTS RECORD of " << QDateTime::currentDateTime().toString("dd.MM.yyyy")
+                          << "\nSource: " << source
+                          << "\nhh:mm:ss\tHeartRate, bpm\tSNR, dB\tBreathRate, rpm\tSNR, dB\tCPU, %\n";
+
+    //--------------------Processing on the shared workers-----------
+    quint16 worker = v_streams.size() % m_threadCount;
+    stream.pt_harmonic = new QHarmonicProcessor(NULL, m_dataLength, m_bufferLength);
+    stream.pt_ring = new QFrameRing(DEFAULT_FRAME_RING_LENGTH);
+    stream.pt_ring->setPolicy(QFrameRing::LatestPolicy); // a late stream takes the newest frame and does not hold the worker with old ones
+    stream.pt_processor->setFrameRing(stream.pt_ring);
+    stream.pt_processor->moveToThread(&v_threads[worker]);
+    stream.pt_harmonic->moveToThread(&v_threads[worker]);
+    connect(stream.pt_processor, SIGNAL(frameDequeued(cv::Mat)), stream.pt_processor, SLOT(faceProcess(cv::Mat)), Qt::DirectConnection);
+    connect(stream.pt_processor, SIGNAL(dataCollected(ulong,ulong,ulong,ulong,double)), stream.pt_harmonic, SLOT(EnrollData(ulong,ulong,ulong,ulong,double)));
+    connect(stream.pt_processor, SIGNAL(stagesTimed(qreal,qreal)), this, SLOT(accountStages(qreal,qreal)));
+    connect(this, SIGNAL(updateStreams()), stream.pt_harmonic, SLOT(computeHeartRate()));
+    connect(this, SIGNAL(updateStreams()), stream.pt_harmonic, SLOT(computeBreathRate()));
+    connect(stream.pt_harmonic, SIGNAL(measurementsUpdated(qreal,qreal,qreal,qreal)), this, SLOT(recordMeasurements(qreal,qreal,qreal,qreal)));
+
+    //--------------------Capture in own thread----------------------
+    stream.pt_captureThread = new QThread(this);
+    stream.pt_capture = new QVideoCapture();
+    stream.pt_capture->setFrameRing(stream.pt_ring);
+    stream.pt_capture->moveToThread(stream.pt_captureThread);
+    connect(stream.pt_captureThread, &QThread::started, stream.pt_capture, &QVideoCapture::initiallizeTimer);
+    connect(stream.pt_capture, SIGNAL(frameQueued()), stream.pt_processor, SLOT(processQueuedFrames()));
+    stream.pt_captureThread->start();
+
+    v_streams.append(stream);
+    return v_streams.size() - 1;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QStreamManager::addFileStream(const QString &filename, const QString &cascade, const QString &record)
+{
+    int id = createStream(filename, cascade, record);
+    if(id < 0)
+    {
+        return -1;
+    }
+    bool opened = false;
+    QMetaObject::invokeMethod(v_streams[id].pt_capture, "openfile", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, opened), Q_ARG(QString, filename));
+    if(!opened)
+    {
+        qWarning("QStreamManager: can not open %s", filename.toLocal8Bit().constData());
+        discardLastStream();
+        return -1;
+    }
+    QMetaObject::invokeMethod(v_streams[id].pt_capture, "resume", Qt::QueuedConnection);
+    return id;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QStreamManager::addDeviceStream(int device, const QString &cascade, const QString &record)
+{
+    int id = createStream(tr("device %1").arg(device), cascade, record);
+    if(id < 0)
+    {
+        return -1;
+    }
+    bool opened = false;
+    QMetaObject::invokeMethod(v_streams[id].pt_capture, "setDeviceID", Qt::QueuedConnection, Q_ARG(int, device));
+    QMetaObject::invokeMethod(v_streams[id].pt_capture, "opendevice", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, opened), Q_ARG(int, DEFAULT_FRAME_PERIOD));
+    if(!opened)
+    {
+        qWarning("QStreamManager: can not open device %d", device);
+        discardLastStream();
+        return -1;
+    }
+    QMetaObject::invokeMethod(v_streams[id].pt_capture, "resume", Qt::QueuedConnection);
+    return id;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QStreamManager::stopCapture(Stream &stream)
+{
+    QMetaObject::invokeMethod(stream.pt_capture, "close", Qt::BlockingQueuedConnection);
+    stream.pt_captureThread->quit();
+    stream.pt_captureThread->wait();
+    delete stream.pt_capture; // thread is finished, so object can be deleted from here
+    delete stream.pt_captureThread;
+    stream.pt_capture = NULL;
+    stream.pt_captureThread = NULL;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QStreamManager::discardLastStream()
+{
+    Stream stream = v_streams.takeLast();
+    stopCapture(stream);
+    stream.pt_processor->deleteLater(); // no frames were captured, so the ring is not used by the processor
+    stream.pt_harmonic->deleteLater();
+    delete stream.pt_ring;
+    delete stream.pt_textStream;
+    stream.pt_file->remove();
+    delete stream.pt_file;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QStreamManager::setEstimationPeriod(int value)
+{
+    if(value > 0)
+    {
+        m_timer.setInterval(value);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QStreamManager::pauseAll()
+{
+    for(int i = 0; i < v_streams.size(); i++)
+    {
+        QMetaObject::invokeMethod(v_streams[i].pt_capture, "pause", Qt::QueuedConnection);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QStreamManager::resumeAll()
+{
+    for(int i = 0; i < v_streams.size(); i++)
+    {
+        QMetaObject::invokeMethod(v_streams[i].pt_capture, "resume", Qt::QueuedConnection);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QStreamManager::count() const
+{
+    return v_streams.size();
+}
+
+//------------------------------------------------------------------------------------------------------
+
+quint16 QStreamManager::threadCount() const
+{
+    return m_threadCount;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QStreamManager::findStream(QObject *object) const
+{
+    for(int i = 0; i < v_streams.size(); i++)
+    {
+        if( (v_streams[i].pt_processor == object) || (v_streams[i].pt_harmonic == object) )
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QStreamManager::accountStages(qreal capture_time, qreal processing_time)
+{
+    int id = findStream(sender());
+    if(id >= 0)
+    {
+        v_streams[id].m_busyTime += capture_time + processing_time;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QStreamManager::recordMeasurements(qreal heart_rate, qreal heart_snr, qreal breath_rate, qreal breath_snr)
+{
+    int id = findStream(sender());
+    if(id < 0)
+    {
+        return;
+    }
+    Stream &stream = v_streams[id];
+    qint64 time = m_clock.elapsed();
+    qreal load = (time > stream.m_recordTime) ? stream.m_busyTime / (time - stream.m_recordTime) : 0.0;
+    stream.m_recordTime = time;
+    stream.m_busyTime = 0.0;
+
+    *stream.pt_textStream << QTime::currentTime().toString("hh:mm:ss")
+                          << "\t" << qRound(heart_rate) << "\t"
+                          << heart_snr << "\t" << qRound(breath_rate)
+                          << "\t" << breath_snr << "\t" << 100.0 * load << "\n";
+    emit streamMeasured(id, heart_rate, heart_snr, breath_rate, breath_snr, load);
+}
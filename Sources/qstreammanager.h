@@ -0,0 +1,86 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QStreamManager runs several independent capture -> ROI -> harmonic pipelines in one process. Every
+stream has its own QVideoCapture thread, QFrameRing, QOpencvProcessor and QHarmonicProcessor, image and
+harmonic processors of all streams share a pool of worker threads (round-robin assignment, like
+QHarmonicProcessorMap does for the map cells). ROI is found by face detection, so a cascade is needed.
+Each stream writes its own measurements record, the last column is a share of one CPU core that was
+spent on capture and image processing of the stream since the previous record.
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QSTREAMMANAGER_H
+#define QSTREAMMANAGER_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QVector>
+
+#include "qvideocapture.h"
+#include "qframering.h"
+#include "qopencvprocessor.h"
+#include "qharmonicprocessor.h"
+
+#define DEFAULT_STREAM_ESTIMATION_PERIOD 1000 // ms
+
+//------------------------------------------------------------------------------------------------------
+
+class QStreamManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QStreamManager(QObject *parent = 0, quint16 threads = 0, quint16 length_of_data = 256, quint16 length_of_buffer = 256); // threads = 0 means QThread::idealThreadCount()
+    ~QStreamManager();
+
+signals:
+    void updateStreams();   // drives harmonic processors of all streams
+    void streamMeasured(int id, qreal heart_rate, qreal heart_snr, qreal breath_rate, qreal breath_snr, qreal cpu_load);
+
+public slots:
+    int addFileStream(const QString &filename, const QString &cascade, const QString &record);  // returns id of the stream or -1 on failure, record is the name of measurements file
+    int addDeviceStream(int device, const QString &cascade, const QString &record);
+    void setEstimationPeriod(int value);    // ms between heart rate and breath rate estimations
+    void pauseAll();
+    void resumeAll();
+    int count() const;
+    quint16 threadCount() const;
+
+private:
+    struct Stream
+    {
+        QString source;
+        QThread *pt_captureThread;
+        QVideoCapture *pt_capture;
+        QFrameRing *pt_ring;
+        QOpencvProcessor *pt_processor;
+        QHarmonicProcessor *pt_harmonic;
+        QFile *pt_file;
+        QTextStream *pt_textStream;
+        qreal m_busyTime;   // time spent on capture and image processing since the previous record, in ms
+        qint64 m_recordTime;    // m_clock value of the previous record, in ms
+    };
+
+    QVector<Stream> v_streams;
+    QThread *v_threads;
+    quint16 m_threadCount;
+    quint16 m_dataLength;
+    quint16 m_bufferLength;
+    QTimer m_timer;
+    QElapsedTimer m_clock;  // measures time between the records for the CPU load evaluation
+
+    int createStream(const QString &source, const QString &cascade, const QString &record); // creates all objects of the stream, capture should be opened after this call
+    void stopCapture(Stream &stream);      // closes the source and stops capture thread of the stream
+    void discardLastStream();               // removes the stream whose source could not be opened
+    int findStream(QObject *object) const; // returns id of the stream that owns object
+
+private slots:
+    void accountStages(qreal capture_time, qreal processing_time);
+    void recordMeasurements(qreal heart_rate, qreal heart_snr, qreal breath_rate, qreal breath_snr);
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QSTREAMMANAGER_H
@@ -0,0 +1,202 @@
+/*------------------------------------------------------------------------------------------------------
+									     SOURCE FILE
+QSyntheticVideo generates frames with a skin coloured ellipse whose green channel is modulated by known
+heart and breath frequencies, plus gaussian noise and motion of the ellipse. It gives hardware-free
+input with ground truth for benchmarks and accuracy checks. Every frame depends only on its number
+and on the parameters (noise is produced by cv::RNG seeded with the frame number), so output is
+bit-reproducible regardless of playback speed and seeking.
+------------------------------------------------------------------------------------------------------*/
+
+#include "qsyntheticvideo.h"
+#include <QFileInfo>
+#include <QSettings>
+
+#define SKIN_BLUE 120       // passes modified Kovac's rule of QOpencvProcessor::isSkinColor(...)
+#define SKIN_GREEN 140
+#define SKIN_RED 200
+#define BACKGROUND_LEVEL 64
+#define MOTION_FREQUENCY 0.2 // Hz, frequency of the ellipse sway
+
+//------------------------------------------------------------------------------------------------------
+
+QSyntheticVideo::Parameters::Parameters():
+    width(640),
+    height(480),
+    fps(30.0),
+    frames(30*60*5),
+    heartRate(72.0),
+    breathRate(15.0),
+    heartAmplitude(1.0),
+    breathAmplitude(2.0),
+    noiseSigma(2.0),
+    motion(0.0),
+    seed(1)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+QSyntheticVideo::QSyntheticVideo():
+    m_openedFlag(false),
+    m_position(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSyntheticVideo::isSupported(const QString &filename)
+{
+    return QFileInfo(filename).suffix().toLower() == "synth";
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSyntheticVideo::open(const QString &filename)
+{
+    if(!QFileInfo(filename).exists())
+    {
+        return false;
+    }
+    QSettings settings(filename, QSettings::IniFormat);
+    Parameters defaults;
+    Parameters parameters;
+    parameters.width = settings.value("video/width", defaults.width).toInt();
+    parameters.height = settings.value("video/height", defaults.height).toInt();
+    parameters.fps = settings.value("video/fps", defaults.fps).toDouble();
+    parameters.frames = settings.value("video/frames", defaults.frames).toInt();
+    parameters.heartRate = settings.value("signal/heart_rate", defaults.heartRate).toDouble();
+    parameters.breathRate = settings.value("signal/breath_rate", defaults.breathRate).toDouble();
+    parameters.heartAmplitude = settings.value("signal/heart_amplitude", defaults.heartAmplitude).toDouble();
+    parameters.breathAmplitude = settings.value("signal/breath_amplitude", defaults.breathAmplitude).toDouble();
+    parameters.noiseSigma = settings.value("noise/sigma", defaults.noiseSigma).toDouble();
+    parameters.motion = settings.value("noise/motion", defaults.motion).toDouble();
+    parameters.seed = settings.value("noise/seed", defaults.seed).toUInt();
+    return open(parameters);
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSyntheticVideo::open(const Parameters &parameters)
+{
+    close();
+    if((parameters.width < 16) || (parameters.height < 16) || (parameters.fps <= 0.0) || (parameters.frames <= 0))
+    {
+        return false;
+    }
+    m_parameters = parameters;
+    m_openedFlag = true;
+    m_position = 0;
+    qWarning("QSyntheticVideo: %dx%d at %.2f fps, heart rate %.1f bpm, breath rate %.1f rpm", m_parameters.width, m_parameters.height, m_parameters.fps, m_parameters.heartRate, m_parameters.breathRate);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSyntheticVideo::close()
+{
+    m_openedFlag = false;
+    m_position = 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSyntheticVideo::isOpened() const
+{
+    return m_openedFlag;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSyntheticVideo::read(cv::Mat &frame)
+{
+    if(!m_openedFlag || (m_position >= m_parameters.frames))
+    {
+        return false;
+    }
+    render(frame, m_position);
+    m_position++;
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+void QSyntheticVideo::render(cv::Mat &frame, int number)
+{
+    if(frame.refcount == NULL)
+    {
+        frame.release(); // frame points into a file mapping, it should not be overwritten
+    }
+    // the scene is rendered in floating point and rounded once after the noise is added, so the noise dithers
+    // the sub-level modulation (heart amplitude is about 1 level) instead of a staircase of rounded levels
+    m_canvas.create(m_parameters.height, m_parameters.width, CV_32FC3);
+    m_canvas.setTo(cv::Scalar(BACKGROUND_LEVEL, BACKGROUND_LEVEL, BACKGROUND_LEVEL));
+
+    double t = number / m_parameters.fps; // s
+    double heart = m_parameters.heartAmplitude * std::sin(2.0 * CV_PI * m_parameters.heartRate / 60.0 * t);
+    double breath = m_parameters.breathAmplitude * std::sin(2.0 * CV_PI * m_parameters.breathRate / 60.0 * t);
+    double sway = m_parameters.motion * std::sin(2.0 * CV_PI * MOTION_FREQUENCY * t);
+
+    cv::Point center(cvRound(m_parameters.width / 2.0 + sway), cvRound(m_parameters.height / 2.0 + 0.5 * sway));
+    cv::Size axes(m_parameters.width / 6, m_parameters.height / 4);
+    m_mask.create(m_parameters.height, m_parameters.width, CV_8UC1);
+    m_mask.setTo(cv::Scalar(0));
+    cv::ellipse(m_mask, center, axes, 0.0, 0.0, 360.0, cv::Scalar(255), -1);
+    m_canvas.setTo(cv::Scalar(SKIN_BLUE + breath, SKIN_GREEN + heart + breath, SKIN_RED + breath), m_mask); // fractional levels are kept
+
+    if(m_parameters.noiseSigma > 0.0)
+    {
+        cv::RNG rng( (quint64)m_parameters.seed * 0x9E3779B97F4A7C15ULL + (quint64)number ); // the same frame number gives the same noise
+        m_noise.create(m_canvas.size(), CV_32FC3);
+        rng.fill(m_noise, cv::RNG::NORMAL, cv::Scalar::all(0.0), cv::Scalar::all(m_parameters.noiseSigma));
+        m_canvas += m_noise;
+    }
+    frame.create(m_parameters.height, m_parameters.width, CV_8UC3);
+    m_canvas.convertTo(frame, CV_8U); // rounds and saturates
+}
+
+//------------------------------------------------------------------------------------------------------
+
+bool QSyntheticVideo::seek(int number)
+{
+    if(m_openedFlag && (number >= 0) && (number <= m_parameters.frames))
+    {
+        m_position = number;
+        return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QSyntheticVideo::position() const
+{
+    return m_position;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+int QSyntheticVideo::frameCount() const
+{
+    return m_openedFlag ? m_parameters.frames : 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+double QSyntheticVideo::fps() const
+{
+    return m_parameters.fps;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+double QSyntheticVideo::timestamp() const
+{
+    return (m_position - 1) * 1000.0 / m_parameters.fps;
+}
+
+//------------------------------------------------------------------------------------------------------
+
+const QSyntheticVideo::Parameters &QSyntheticVideo::parameters() const
+{
+    return m_parameters;
+}
@@ -0,0 +1,69 @@
+/*------------------------------------------------------------------------------------------------------
+									     HEADER FILE
+QSyntheticVideo generates frames with a skin coloured ellipse whose green channel is modulated by known
+heart and breath frequencies, plus gaussian noise and motion of the ellipse. It gives hardware-free
+input with ground truth for benchmarks and accuracy checks. Every frame depends only on its number
+and on the parameters (noise is produced by cv::RNG seeded with the frame number), so output is
+bit-reproducible regardless of playback speed and seeking.
+Parameters are read from *.synth INI file, all keys are optional:
+    [video]  width, height, fps, frames
+    [signal] heart_rate (bpm), breath_rate (rpm), heart_amplitude, breath_amplitude (levels of green)
+    [noise]  sigma (levels), motion (pixels), seed
+------------------------------------------------------------------------------------------------------*/
+
+#ifndef QSYNTHETICVIDEO_H
+#define QSYNTHETICVIDEO_H
+//------------------------------------------------------------------------------------------------------
+
+#include <QString>
+#include <opencv2/opencv.hpp>
+
+//------------------------------------------------------------------------------------------------------
+
+class QSyntheticVideo
+{
+public:
+    struct Parameters
+    {
+        int width;
+        int height;
+        double fps;
+        int frames;
+        double heartRate;       // bpm
+        double breathRate;      // rpm
+        double heartAmplitude;  // amplitude of green modulation by heart, levels
+        double breathAmplitude; // amplitude of brightness modulation by breath, levels
+        double noiseSigma;      // standard deviation of gaussian noise, levels
+        double motion;          // amplitude of the ellipse motion, pixels
+        quint32 seed;
+        Parameters();
+    };
+
+    QSyntheticVideo();
+
+    bool open(const QString &filename);         // reads parameters from *.synth file
+    bool open(const Parameters &parameters);
+    void close();
+    bool isOpened() const;
+    bool read(cv::Mat &frame);                  // renders the next frame into frame
+    bool seek(int number);                      // sets the number of the next frame
+    int position() const;                       // returns the number of the next frame
+    int frameCount() const;
+    double fps() const;
+    double timestamp() const;                   // returns timestamp of the last read frame, in ms
+    const Parameters &parameters() const;       // ground truth
+    static bool isSupported(const QString &filename);
+
+private:
+    Parameters m_parameters;
+    bool m_openedFlag;
+    int m_position;
+    cv::Mat m_canvas;       // frame in floating point, see render(...)
+    cv::Mat m_mask;         // ellipse of the frame
+    cv::Mat m_noise;
+
+    void render(cv::Mat &frame, int number);
+};
+
+//------------------------------------------------------------------------------------------------------
+#endif // QSYNTHETICVIDEO_H
@@ -3,6 +3,7 @@ Taranov Alex, 2014 									    SOURCE FILE
 QVideoCapture class was created as Qt SIGNAL/SLOT wrapper for OpenCV VideoCapture class
 Work with: call openfile(...) or opendevice(...) and on success, object will start to emit
 frame_was_captured(const cv::Mat& value) signal with determined period of time.
+If QFrameRing was assigned by setFrameRing(...), frames are written into the ring and frameQueued() is emitted instead.
 To stop frame capturing use pause() or close(). Also
 class provides some GUI interface to cv::VideoCapture::set(...) function.
 ------------------------------------------------------------------------------------------------------*/
@@ -11,31 +12,99 @@ class provides some GUI interface to cv::VideoCapture::set(...) function.
 
 QVideoCapture::QVideoCapture(QObject *parent) :
     QObject(parent),
-    device_id(0)
+    device_id(0),
+    pt_ring(NULL),
+    m_unthrottledFlag(false),
+    m_stalledFlag(false),
+    m_nativeYUVFlag(false),
+    m_filePeriod(DEFAULT_FRAME_PERIOD),
+    m_sourceTime(-1.0),
+    m_timestamp(0.0),
+    m_sourceType(OpenCVSource),
+    m_readAheadDepth(0),
+    m_decodeTime(0.0)
 {
 }
 
 bool QVideoCapture::openfile(const QString &filename)
 {
     pt_timer->stop();
-    if( m_cvCapture.open( filename.toLocal8Bit().constData() ) )
+    m_stalledFlag = false;
+    double fps = 0.0;
+    if(QSyntheticVideo::isSupported(filename))
     {
-        m_frameCounter = 0;
-        deviceFlag = false;
-        pt_timer->setInterval( 1000/m_cvCapture.get(CV_CAP_PROP_FPS) ); // CV_CAP_PROP_FPS - m_frame rate
-        return true;
+        if( !m_syntheticVideo.open(filename) )
+        {
+            return false;
+        }
+        m_cvCapture.release();
+        m_mappedVideo.close();
+        m_decoder.close();
+        m_sourceType = SyntheticSource;
+        fps = m_syntheticVideo.fps();
     }
-    return false;
+    else if(QMappedVideo::isSupported(filename))
+    {
+        if( !m_mappedVideo.open(filename) )
+        {
+            return false;
+        }
+        m_cvCapture.release();
+        m_decoder.close();
+        m_syntheticVideo.close();
+        m_sourceType = MappedSource;
+        fps = m_mappedVideo.fps();
+    }
+    else if(m_readAheadDepth > 0)
+    {
+        if( !m_decoder.open(filename, m_readAheadDepth) )
+        {
+            return false;
+        }
+        m_cvCapture.release();
+        m_mappedVideo.close();
+        m_syntheticVideo.close();
+        m_sourceType = ReadAheadSource;
+        fps = m_decoder.fps();
+    }
+    else
+    {
+        if( !m_cvCapture.open( filename.toLocal8Bit().constData() ) )
+        {
+            return false;
+        }
+        m_mappedVideo.close();
+        m_decoder.close();
+        m_syntheticVideo.close();
+        m_sourceType = OpenCVSource;
+        fps = m_cvCapture.get(CV_CAP_PROP_FPS); // CV_CAP_PROP_FPS - m_frame rate
+    }
+    m_frameCounter = 0;
+    deviceFlag = false;
+    m_filePeriod = (fps > 0.0) ? 1000.0/fps : DEFAULT_FRAME_PERIOD;
+    m_sourceTime = -1.0;
+    pt_timer->setInterval( m_unthrottledFlag ? 0 : (int)m_filePeriod ); // zero interval means that frames are read whenever the thread is idle, the timer stops while the ring is full
+    return true;
 }
 
 bool QVideoCapture::opendevice(int period) // period should be entered in ms
 {
     pt_timer->stop();
+    m_stalledFlag = false;
     if(device_id >= 0)
     {
         if( m_cvCapture.open( device_id ) )
         {
+            m_mappedVideo.close();
+            m_decoder.close();
+            m_syntheticVideo.close();
+            m_sourceType = OpenCVSource;
+            if(m_nativeYUVFlag)
+            {
+                m_cvCapture.set(CV_CAP_PROP_CONVERT_RGB, 0.0);
+            }
             deviceFlag = true;
+            m_sourceTime = -1.0;
             pt_timer->setInterval( period );
             return true;
         }
@@ -50,8 +119,10 @@ bool QVideoCapture::set(int propertyID, double value)
 
 bool QVideoCapture::resume()
 {
-    if( m_cvCapture.isOpened() )
+    if( isOpened() )
     {
+        m_sourceTime = -1.0; // time of pause should not be counted
+        m_stalledFlag = false;
         pt_timer->start();
         return true;
     }
@@ -60,7 +131,7 @@ bool QVideoCapture::resume()
 
 bool QVideoCapture::start()
 {
-    if( m_cvCapture.isOpened() )
+    if( isOpened() )
     {
         if(deviceFlag)
         {
@@ -77,10 +148,14 @@ bool QVideoCapture::start()
 
 bool QVideoCapture::close()
 {
-    if( m_cvCapture.isOpened() )
+    if( isOpened() )
     {
         pt_timer->stop();
+        m_stalledFlag = false;
         m_cvCapture.release();
+        m_mappedVideo.close();
+        m_decoder.close();
+        m_syntheticVideo.close();
         return true;
     }
     return false;
@@ -88,22 +163,227 @@ bool QVideoCapture::close()
 
 bool QVideoCapture::pause()
 {
-    if( m_cvCapture.isOpened() )
+    if( isOpened() )
     {
         pt_timer->stop();
+        m_stalledFlag = false; // slots freed during the pause should not resume reading
         return true;
     }
     return false;
 }
 
+bool QVideoCapture::grabFrame(cv::Mat &frame, double &sourceTime, QFrameRing::PixelFormat &format)
+{
+    format = QFrameRing::BGRFormat;
+    switch(m_sourceType)
+    {
+        case MappedSource:
+            if( m_mappedVideo.read(frame) )
+            {
+                sourceTime = m_mappedVideo.timestamp();
+                if(m_mappedVideo.isNativeYUV())
+                {
+                    format = QFrameRing::I420Format;
+                }
+                return true;
+            }
+            return false;
+        case ReadAheadSource:
+            if( m_decoder.take(frame, sourceTime, m_decodeTime) )
+            {
+                emit readAheadDepth(m_decoder.count());
+                return true;
+            }
+            return false;
+        case SyntheticSource:
+            if( m_syntheticVideo.read(frame) )
+            {
+                sourceTime = m_syntheticVideo.timestamp();
+                return true;
+            }
+            return false;
+        default:
+            if(frame.refcount == NULL)
+            {
+                frame.release(); // frame points into a file mapping, it should not be overwritten
+            }
+            if( advanceFrame(sourceTime) )
+            {
+                if( !m_cvCapture.retrieve(frame) || frame.empty() )
+                {
+                    return false;
+                }
+                if(m_nativeYUVFlag && deviceFlag)
+                {
+                    if(frame.type() == CV_8UC2)
+                    {
+                        format = QFrameRing::YUYVFormat;
+                    }
+                    else if(frame.type() != CV_8UC3)
+                    {
+                        qWarning("QVideoCapture: device does not provide packed YUV, BGR conversion is restored");
+                        m_nativeYUVFlag = false;
+                        m_cvCapture.set(CV_CAP_PROP_CONVERT_RGB, 1.0);
+                        return m_cvCapture.retrieve(frame) && ( !frame.empty() );
+                    }
+                }
+                return true;
+            }
+            return false;
+    }
+}
+
+bool QVideoCapture::advanceFrame(double &sourceTime)
+{
+    if(m_sourceType == MappedSource)
+    {
+        if( (!m_mappedVideo.isOpened()) || (m_mappedVideo.position() >= m_mappedVideo.frameCount()) )
+        {
+            return false;
+        }
+        m_mappedVideo.seek(m_mappedVideo.position() + 1);
+        sourceTime = m_mappedVideo.timestamp();
+        return true;
+    }
+    if(m_sourceType == ReadAheadSource)
+    {
+        return m_decoder.take(m_frame, sourceTime, m_decodeTime); // decoded frame is just dropped
+    }
+    if(m_sourceType == SyntheticSource)
+    {
+        if( !m_syntheticVideo.seek(m_syntheticVideo.position() + 1) )
+        {
+            return false;
+        }
+        sourceTime = m_syntheticVideo.timestamp();
+        return true;
+    }
+    if( m_cvCapture.grab() )
+    {
+        if(deviceFlag)
+        {
+            sourceTime = cv::getTickCount() * 1000.0 / cv::getTickFrequency(); // time when grab returned the new frame
+        }
+        else
+        {
+            sourceTime = m_cvCapture.get(CV_CAP_PROP_POS_MSEC); // container timestamp of the frame
+        }
+        return true;
+    }
+    return false;
+}
+
+int QVideoCapture::framePosition()
+{
+    if(m_sourceType == MappedSource)
+    {
+        return m_mappedVideo.position();
+    }
+    if(m_sourceType == ReadAheadSource)
+    {
+        return m_decoder.position();
+    }
+    if(m_sourceType == SyntheticSource)
+    {
+        return m_syntheticVideo.position();
+    }
+    return (int)m_cvCapture.get(CV_CAP_PROP_POS_FRAMES);
+}
+
 bool QVideoCapture::read_frame()
 {
-    if( ( m_cvCapture.read(m_frame) ) && ( !m_frame.empty() ) )
+    if( (m_sourceType == ReadAheadSource) && (m_decoder.count() == 0) )
+    {
+        if(m_decoder.atEnd())
+        {
+            this->pause();
+            return false;
+        }
+        if(m_unthrottledFlag)
+        {
+            m_decoder.waitForFrame((unsigned long)m_filePeriod + 1); // blocks instead of spinning the zero interval timer
+        }
+        return true; // decoder is late, the frame will be taken on the next tick
+    }
+
+    if(pt_ring)
     {
+        return write_frame();
+    }
+
+    double sourceTime;
+    QFrameRing::PixelFormat format;
+    if( grabFrame(m_frame, sourceTime, format) )
+    {
+        if(format == QFrameRing::I420Format)
+        {
+            cv::cvtColor(m_frame, m_frame, CV_YUV2BGR_I420); // frame_was_captured(...) receivers expect BGR
+        }
+        else if(format == QFrameRing::YUYVFormat)
+        {
+            cv::cvtColor(m_frame, m_frame, CV_YUV2BGR_YUY2);
+        }
         emit frame_was_captured(m_frame);
         if(!deviceFlag)
         {
-            emit capturedFrameNumber((int)m_cvCapture.get(CV_CAP_PROP_POS_FRAMES));
+            emit capturedFrameNumber(framePosition());
+        }
+        return true;
+    }
+    else
+    {
+        this->pause();
+        return false;
+    }
+}
+
+bool QVideoCapture::write_frame()
+{
+    QFrameRing::Slot *slot = pt_ring->writeSlot();
+    if(slot == NULL)
+    {
+        if( (pt_ring->policy() == QFrameRing::BoundedPolicy) && (deviceFlag || !m_unthrottledFlag) )
+        {
+            // the consumer is late, drop the frame but keep device buffer fresh, the dropped frame still advances the timestamp
+            double sourceTime;
+            if( !advanceFrame(sourceTime) )
+            {
+                this->pause();
+                return false;
+            }
+            stampFrame(sourceTime);
+            pt_ring->countDropped();
+            if(!deviceFlag)
+            {
+                emit capturedFrameNumber(framePosition());
+            }
+        }
+        else if(m_unthrottledFlag && !deviceFlag)
+        {
+            pt_timer->stop(); // nothing to do till the consumer frees a slot, continueWriting() restarts the timer
+            m_stalledFlag = true;
+        }
+        return true; // for BlockPolicy the frame will be read on the next tick, so nothing is lost
+    }
+
+    int64 startTime = cv::getTickCount();
+    double sourceTime;
+    if( grabFrame(slot->frame, sourceTime, slot->format) )
+    {
+        if(m_sourceType == ReadAheadSource)
+        {
+            slot->captureTime = m_decodeTime; // frame was taken from the queue, so decoding time tells more
+        }
+        else
+        {
+            slot->captureTime = (cv::getTickCount() - startTime) * 1000.0 / cv::getTickFrequency();
+        }
+        slot->timestamp = stampFrame(sourceTime);
+        pt_ring->commit();
+        emit frameQueued();
+        if(!deviceFlag)
+        {
+            emit capturedFrameNumber(framePosition());
         }
         return true;
     }
@@ -370,7 +650,7 @@ bool QVideoCapture::open_settingsDialog()
 
 bool QVideoCapture::isOpened()
 {
-    return m_cvCapture.isOpened();
+    return m_cvCapture.isOpened() || m_mappedVideo.isOpened() || m_decoder.isOpened() || m_syntheticVideo.isOpened();
 }
 
 QVideoCapture::~QVideoCapture()
@@ -476,13 +756,99 @@ void QVideoCapture::initiallizeTimer()
 
 double QVideoCapture::getFrameCounts()
 {
+    if(m_sourceType == MappedSource)
+    {
+        return m_mappedVideo.frameCount();
+    }
+    if(m_sourceType == ReadAheadSource)
+    {
+        return m_decoder.frameCount();
+    }
+    if(m_sourceType == SyntheticSource)
+    {
+        return m_syntheticVideo.frameCount();
+    }
     return m_cvCapture.get(CV_CAP_PROP_FRAME_COUNT);
 }
 
 void QVideoCapture::setFrameNumber(int number)
 {
-    if( !m_cvCapture.set(CV_CAP_PROP_POS_FRAMES, number) )
+    bool result;
+    if(m_sourceType == MappedSource)
+    {
+        result = m_mappedVideo.seek(number);
+    }
+    else if(m_sourceType == ReadAheadSource)
+    {
+        result = m_decoder.seek(number);
+    }
+    else if(m_sourceType == SyntheticSource)
+    {
+        result = m_syntheticVideo.seek(number);
+    }
+    else
+    {
+        result = m_cvCapture.set(CV_CAP_PROP_POS_FRAMES, number);
+    }
+    if( !result )
     {
         qWarning("Can not set such frame number");
     }
+    m_sourceTime = -1.0;
+}
+
+void QVideoCapture::setFrameRing(QFrameRing *ring)
+{
+    pt_ring = ring;
+}
+
+void QVideoCapture::setUnthrottled(bool value)
+{
+    m_unthrottledFlag = value;
+    if(isOpened() && !deviceFlag)
+    {
+        pt_timer->setInterval( m_unthrottledFlag ? 0 : (int)m_filePeriod );
+    }
+    continueWriting(); // throttled playback does not wait for the consumer
+}
+
+void QVideoCapture::continueWriting()
+{
+    if(m_stalledFlag)
+    {
+        m_stalledFlag = false;
+        pt_timer->start();
+    }
+}
+
+void QVideoCapture::setReadAheadDepth(int value)
+{
+    m_readAheadDepth = (value > 0) ? value : 0;
+}
+
+void QVideoCapture::setDeviceID(int value)
+{
+    device_id = value;
+}
+
+void QVideoCapture::setNativeYUV(bool value)
+{
+    m_nativeYUVFlag = value;
+    m_mappedVideo.setNativeYUV(value);
+    if(m_cvCapture.isOpened() && deviceFlag)
+    {
+        m_cvCapture.set(CV_CAP_PROP_CONVERT_RGB, value ? 0.0 : 1.0);
+    }
+}
+
+double QVideoCapture::stampFrame(double sourceTime)
+{
+    double delta = sourceTime - m_sourceTime;
+    if( (m_sourceTime < 0.0) || (delta <= 0.0) || (!deviceFlag && (delta > 10*m_filePeriod)) )
+    {
+        delta = deviceFlag ? pt_timer->interval() : m_filePeriod; // first frame after open, resume or seek, also broken file timestamps
+    }
+    m_sourceTime = sourceTime;
+    m_timestamp += delta;
+    return m_timestamp;
 }
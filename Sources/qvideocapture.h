@@ -3,6 +3,7 @@ Taranov Alex, 2014 									    HEADER FILE
 QVideoCapture class was created as Qt SIGNAL/SLOT wrapper for OpenCV VideoCapture class
 Work with: call openfile(...) or opendevice(...) and on success, object will start to emit
 frame_was_captured(const cv::Mat& value) signal with determined period of time.
+If QFrameRing was assigned by setFrameRing(...), frames are written into the ring and frameQueued() is emitted instead.
 To stop frame capturing use pause() or close(). Also
 class provides some GUI interface to cv::VideoCapture::set(...) function.
 ------------------------------------------------------------------------------------------------------*/
@@ -28,6 +29,11 @@ class provides some GUI interface to cv::VideoCapture::set(...) function.
 
 #include <opencv2/opencv.hpp>
 
+#include "qframering.h"
+#include "qmappedvideo.h"
+#include "qreadaheaddecoder.h"
+#include "qsyntheticvideo.h"
+
 //---------------------------In most cases the following values are suitable-------------------------
 #define MIN_BRIGHTNESS 0
 #define MAX_BRIGHTNESS 255
@@ -62,10 +68,13 @@ class QVideoCapture : public QObject
 public:
     explicit QVideoCapture(QObject *parent = 0);
     ~QVideoCapture();
+    enum SourceType { OpenCVSource, MappedSource, ReadAheadSource, SyntheticSource };
 
 signals:
     void frame_was_captured(const cv::Mat& value); // should be emmited right after a new frame was captured, to use in your own Qt-projects first do qRegisterMetaType<cv::Mat>("cv::Mat")
     void capturedFrameNumber(const int number);
+    void frameQueued();                             // emitted when a new frame was written into QFrameRing, connect it to the consumer by Qt::QueuedConnection
+    void readAheadDepth(quint16 frames);            // number of decoded frames left in the read-ahead queue after a frame was taken
     //------------------------------------------
     void set_default_brightness(int value);
     void set_default_contrast(int value);
@@ -79,7 +88,7 @@ signals:
 public slots:
     void initiallizeTimer();                            // allocates memory for internal QTimer and connects them to read_farame slot
     //-----------------------------------------
-    bool openfile(const QString &filename);             // this function should to call cv::VideoCapture::open(filename)
+    bool openfile(const QString &filename);             // this function should to call cv::VideoCapture::open(filename), *.y4m and *.bgr files are opened through QMappedVideo, *.synth through QSyntheticVideo
     bool opendevice(int period = DEFAULT_FRAME_PERIOD); // this function should to call cv::VideoCapture::open(device)
     bool isOpened();                                    // return true if cv::VideoCapture is opened
     bool start();                                       // starts the grabbing
@@ -91,6 +100,12 @@ public slots:
     bool open_settingsDialog();                         // creates an QDialog instance with video device characteristic-controls, should be used as a GUI implementation of the camera controll functions
     double getFrameCounts();
     void setFrameNumber(int number);
+    void setFrameRing(QFrameRing *ring);                // frames will be written into the ring instead of frame_was_captured(...) emission, pass NULL to switch back
+    void setUnthrottled(bool value);                    // if true, video file frames are read as fast as the consumer takes them, timing is taken from the file timestamps, frames are never dropped
+    void setNativeYUV(bool value);                      // if true, YUV frames from the device or Y4M file are put into QFrameRing without conversion to BGR
+    void setDeviceID(int value);                        // selects device for opendevice(...) without GUI, see open_deviceSelectDialog()
+    void setReadAheadDepth(int value);                  // video files opened after this call are decoded in background thread with value frames ahead, 0 means decoding on the timer tick
+    void continueWriting();                             // the consumer has freed slots of QFrameRing, restarts unthrottled reading stalled on the full ring
     //------------------------------------------
     bool set(int propertyID , double value);// this function should to call cv::VideoCapture::set(propertyID, value)
     bool set_brightness(int value);
@@ -110,6 +125,25 @@ private:
     bool deviceFlag;                        // this flag should to show when frames are grabbing from video device [true] and when from video file [false] (I was using it for settings and resolution dialogs, which can't be called for video files playback)
     int device_id;                          // stores the curent device identifier, 0 on default    
     int m_frameCounter;                     // stores vurrent number of frame in video file
+    QFrameRing *pt_ring;                    // a ring for frames passing to the consumer thread, NULL by default
+    bool m_unthrottledFlag;                 // controls video file playback speed, see setUnthrottled(...)
+    bool m_stalledFlag;                     // unthrottled reading has stopped the timer on the full ring, see continueWriting()
+    bool m_nativeYUVFlag;                   // see setNativeYUV(...)
+    double m_filePeriod;                    // nominal frame period of the opened video file, in ms
+    double m_sourceTime;                    // source time of the last frame (cv::getTickCount() for device, container timestamp for video file), in ms, negative after open, resume or seek
+    double m_timestamp;                     // monotonic timestamp of the last frame, it does not advance while capture is paused, in ms
+    SourceType m_sourceType;                // which object provides frames
+    QMappedVideo m_mappedVideo;             // memory mapped uncompressed video file
+    QReadAheadDecoder m_decoder;            // background decoder of compressed video file
+    quint16 m_readAheadDepth;
+    double m_decodeTime;                    // decoding time of the last frame taken from m_decoder, in ms
+    QSyntheticVideo m_syntheticVideo;       // generator of the test video with known heart and breath rates
+
+    bool write_frame();                     // reads frame directly into the free slot of pt_ring
+    double stampFrame(double sourceTime);   // converts source time of the just grabbed frame to monotonic timestamp
+    bool grabFrame(cv::Mat &frame, double &sourceTime, QFrameRing::PixelFormat &format); // reads the next frame from the current source
+    bool advanceFrame(double &sourceTime);  // moves the current source to the next frame without decoding, also used to drop frames
+    int framePosition();                    // returns the number of the next frame of the video file
 
 private slots:
     bool read_frame();                      // calls cv::VideoCapture::read()